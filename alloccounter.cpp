@@ -0,0 +1,178 @@
+#include "alloccounter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+
+#include <stdlib.h>
+
+#if defined(__GLIBC__) && defined(ASYMREG_COUNT_ALLOCATIONS)
+#  define ALLOCCOUNTER_WRAP_MALLOC
+#endif
+
+/* Counters:
+ * =========
+ * Every thread counts in a slot of its own, so an allocation needs no atomic
+ * read-modify-write and the threads do not share cache lines. allocations()
+ * and bytes() sum up the slots on demand. Slots are not reused, threads
+ * beyond MaxSlots share the last one. */
+struct Slot
+{
+    std::atomic<unsigned long long> allocations;
+    std::atomic<unsigned long long> bytes;
+    char padding[64 - 2 * sizeof(std::atomic<unsigned long long>)]; // one cache line each
+};
+
+static const int MaxSlots = 256;
+static Slot slots[MaxSlots]; // zero-initialized
+static std::atomic<int> usedSlots(0);
+
+/* plain thread-locals, they do not allocate on first use (static TLS): */
+static thread_local unsigned long long threadAllocationCount = 0;
+static thread_local unsigned long long threadAllocationBytes = 0;
+
+#ifdef ALLOCCOUNTER_WRAP_MALLOC
+static thread_local Slot *threadSlot = nullptr;
+
+static inline void count(size_t size)
+{
+    ++threadAllocationCount;
+    threadAllocationBytes += size;
+
+    Slot *slot = threadSlot;
+    if (slot == nullptr) {
+        const int index = usedSlots.fetch_add(1, std::memory_order_relaxed);
+        slot = threadSlot = &slots[std::min(index, MaxSlots - 1)];
+    }
+
+    if (slot == &slots[MaxSlots - 1]) { // shared
+        slot->allocations.fetch_add(1, std::memory_order_relaxed);
+        slot->bytes.fetch_add(size, std::memory_order_relaxed);
+    } else { // only written by this thread
+        slot->allocations.store(slot->allocations.load(std::memory_order_relaxed) + 1,
+                                std::memory_order_relaxed);
+        slot->bytes.store(slot->bytes.load(std::memory_order_relaxed) + size,
+                          std::memory_order_relaxed);
+    }
+}
+
+extern "C" {
+
+// glibc's own implementations, they are always exported:
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+void *__libc_valloc(size_t size);
+void *__libc_pvalloc(size_t size);
+
+void *malloc(size_t size) __THROW
+{
+    count(size);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t num, size_t size) __THROW
+{
+    count(num * size);
+    return __libc_calloc(num, size);
+}
+
+void *realloc(void *ptr, size_t size) __THROW
+{
+    count(size); // the new size, the old block is not known here
+    return __libc_realloc(ptr, size);
+}
+
+void *memalign(size_t alignment, size_t size) __THROW
+{
+    count(size);
+    return __libc_memalign(alignment, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size) __THROW
+{
+    count(size);
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **ptr, size_t alignment, size_t size) __THROW
+{
+    if ((alignment == 0) || (alignment % sizeof(void *) != 0) || ((alignment & (alignment - 1)) != 0))
+        return EINVAL;
+
+    count(size);
+    void *mem = __libc_memalign(alignment, size);
+    if (mem == nullptr)
+        return ENOMEM;
+
+    *ptr = mem;
+    return 0;
+}
+
+void *valloc(size_t size) __THROW
+{
+    count(size);
+    return __libc_valloc(size);
+}
+
+void *pvalloc(size_t size) __THROW
+{
+    count(size);
+    return __libc_pvalloc(size);
+}
+
+} // extern "C"
+#endif // ALLOCCOUNTER_WRAP_MALLOC
+
+bool AllocationCounter::isAvailable()
+{
+#ifdef ALLOCCOUNTER_WRAP_MALLOC
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief Number of allocations done by all threads.
+ */
+unsigned long long AllocationCounter::allocations()
+{
+    unsigned long long sum = 0;
+    const int used = std::min(usedSlots.load(std::memory_order_relaxed), MaxSlots);
+    for (int i = 0; i < used; ++i)
+        sum += slots[i].allocations.load(std::memory_order_relaxed);
+
+    return sum;
+}
+
+/**
+ * @brief Number of bytes requested by all counted allocations.
+ */
+unsigned long long AllocationCounter::bytes()
+{
+    unsigned long long sum = 0;
+    const int used = std::min(usedSlots.load(std::memory_order_relaxed), MaxSlots);
+    for (int i = 0; i < used; ++i)
+        sum += slots[i].bytes.load(std::memory_order_relaxed);
+
+    return sum;
+}
+
+/**
+ * @brief Number of allocations done by the calling thread.
+ */
+unsigned long long AllocationCounter::threadAllocations()
+{
+    return threadAllocationCount;
+}
+
+/**
+ * @brief Number of bytes requested by the calling thread.
+ */
+unsigned long long AllocationCounter::threadBytes()
+{
+    return threadAllocationBytes;
+}
@@ -0,0 +1,26 @@
+#ifndef ALLOCCOUNTER_H_
+#define ALLOCCOUNTER_H_
+
+/**
+ * Process-wide counter of heap allocations.
+ * If built with ASYMREG_COUNT_ALLOCATIONS (CMake option of the same name) on
+ * glibc systems, malloc(), calloc(), realloc() and the aligned variants are
+ * wrapped, so every heap allocation (including Eigen's, OpenMP's and the C++
+ * runtime's) of all threads is counted. Otherwise the counter is not available
+ * and stays at 0.
+ * Allocations are counted per thread, see threadAllocations(), the process-wide
+ * numbers are summed up on demand.
+ */
+namespace AllocationCounter {
+
+bool isAvailable();
+
+unsigned long long allocations();
+unsigned long long bytes();
+
+unsigned long long threadAllocations();
+unsigned long long threadBytes();
+
+} // namespace AllocationCounter
+
+#endif // ALLOCCOUNTER_H_
@@ -1,274 +1,806 @@
 #include "asymreg.h"
 
+#include <algorithm>
 #include <cfloat>
 #include <cmath>
-#include <iostream>
+#include <limits>
+#include <memory>
+#include <sstream>
 
+#ifdef _OPENMP
+#  include <omp.h>
+#endif
+
+#include "alloccounter.h"
 #include "backprojection.h"
+#include "checkpoint.h"
 #include "constants.h"
+#include "datasetstream.h"
 #include "duration.h"
 #include "eigen.h"
+#include "fourierslice.h"
+#include "funcaccop.h"
 #include "interpol.h"
+#include "logger.h"
 #include "ode.h"
 #include "plotter.h"
 #include "plottersettings.h"
+#include "profiler.h"
+#include "radonmatrix.h"
 #include "radonoperator.h"
+#include "regularizationworkspace.h"
 
 // defines:
-#define STDOUT_MATRIX(MAT) \
-    std::cout << #MAT" =" << std::endl \
-              << MAT << std::endl << std::endl
+#define LOG_MATRIX(MAT) \
+    if (Logger::isEnabled(Logger::Debug)) { \
+        std::ostringstream os; \
+        os << #MAT" =" << std::endl << MAT << std::endl; \
+        Logger::log(Logger::Debug, "matrix", os.str()); \
+    }
 
 // namespaces:
 using hrc = std::chrono::high_resolution_clock;
 
-// local/private functions:
-static void circleBound(double in, double *lower, double *upper);
-static void squareBound(double in, double *lower, double *upper);
-
 // template classes:
 /**
- * @brief Little helper class to transform coordinates from target
- *        to physical coord. system and get data from Asymreg::sourceFunction().
+ * @brief Creates the discrete geometry of @a config.
+ * @param config Geometry of the reconstruction.
+ * @param Sigma Receives the recording angles, one column per angle.
+ * @param S Receives the discrete samples of s-axis (target coord. system).
+ * @param Xsi Receives the discrete samples of x- and y-axis (physical coord. system).
  */
-class SrcFuncAccOp {
-public:
-    SrcFuncAccOp(BilinearInterpol *func)
-        : m_func(func) {}
+static void createGeometry(const ReconstructionConfig &config, MatrixXd *Sigma,
+                           RowVectorXd *S, RowVectorXd *Xsi)
+{
+    const int angles = config.recordingAngles;
 
-    /**
-     * @brief Pass a 2D vector or 'list' of 2D vectors and get source-function data in return.
-     * The given points @a pts are supposed to be in the target coord. system and are
-     * therefore transformed as described below in the code.
-     * After that the BilinearInterpol class is queried for every point and all values
-     * are returned as a vector.
-     * @param pts 2D Vector or Matrix/Array where each column represents a 2D Vector
-     * @return Row-Vector with data values
-     */
-    template <typename Derived>
-    Matrix<typename Derived::Scalar, 1, Dynamic> operator()(const EigenBase<Derived> &pts) const
-    {
-        typedef typename Derived::Index Index;
-        typedef typename Derived::Scalar Scalar;
-
-        EIGEN_STATIC_ASSERT(Derived::RowsAtCompileTime == 2,
-                            THIS_METHOD_IS_ONLY_FOR_OBJECTS_OF_A_SPECIFIC_SIZE);
-
-        /* tr:
-         * ===
-         * coordinate transformation from target coord. system (r,s) \in [0,1]^2
-         * to physical coord. system (x,y) = [0,10]^2
-         * We want: tr(r,s) = (x,y)|T = [2,8]^2  for r,s=0,...,1
-         *  => tr(r,s) = (3*r+5, 3*s+5)
-         *
-         * Todo: documents want (r,s) = D^1  (unit disc)
-         */
-        static Transform<Scalar, 2, Affine> tr = Translation2d(5, 5) * Scaling(5.0);
+    *Xsi = RowVectorXd::LinSpaced(Sequential, config.gridSize, 0., 10.);
 
-        /* translate pts to phys. coord. system: */
-        Matrix<Scalar, 2, Dynamic> xys = tr * pts;
-        eigen_assert((xys.minCoeff() >= 0.0) && (xys.maxCoeff() <= 10.0));
+    ArrayXd Phi = ArrayXd::LinSpaced(Sequential, angles+1, 0., M_PI).head(angles); // head(N) => take only first N entries
+    Sigma->resize(2, angles);
+    Sigma->row(0) = Phi.cos(); // [cos(phi_0), cos(phi_1), ... , cos(phi_n)]
+    Sigma->row(1) = Phi.sin(); // [sin(phi_0), sin(phi_1), ... , sin(phi_n)]
 
-        /* get data from source-function at (x,y):*/
-        Matrix<Scalar, 1, Dynamic> ret(xys.cols()); // init with correct size, even if size is 1
-        for (Index i = 0; i < xys.cols(); ++i)
-            ret[i] = m_func->interpol(xys(0,i), xys(1,i));
+    *S = RowVectorXd::LinSpaced(Sequential, config.numSamples(), -1., 1.);
+}
+
+/**
+ * @brief Assembles the Radon System Matrix @a A for the given geometry.
+ * The forward matrix is built from the same line discretization as RadonOperator
+ * with the weights of a bilinear interpolation on the grid @a Xsi x @a Xsi.
+ * The backward part reproduces the pixel-driven Backprojection, every grid point
+ * gets the value of exactly one sample (or none if it is out of bounds).
+ * @param A RadonMatrix with matching size.
+ * @param config Geometry of the reconstruction.
+ * @param Sigma Recording angles, one column per angle.
+ * @param S Discrete samples of s-axis (target coord. system).
+ * @param Xsi Discrete samples of x- and y-axis (physical coord. system).
+ */
+static void assembleRadonMatrix(RadonMatrix *A, const ReconstructionConfig &config,
+                                const MatrixXd &Sigma, const RowVectorXd &S, const RowVectorXd &Xsi)
+{
+    const int angles = Sigma.cols();
+    const int numSamples = S.size();
+    const int gridSize = Xsi.size();
 
-        return ret;
+    assert((A->numSamples() == numSamples) && (A->gridSize() == gridSize));
+
+    std::vector<RadonMatrix::TripletType> triplets;
+
+    /* forward matrix: */
+    BilinearInterpol interp(Xsi, Xsi, MatrixXd::Zero(gridSize, gridSize)); // only grid is needed
+    SrcFuncAccOp sfao(&interp);
+
+    triplets.reserve(angles * numSamples * numSamples * 4);
+    TrapezoidalRule trapez(config.sampleRate);
+
+    for (int n = 0; n < angles; ++n) {
+        RadonOperator<SrcFuncAccOp, void (double, double *, double *)>
+                Radon(sfao, circleBound, Sigma.col(n), trapez);
+
+        for (int j = 0; j < numSamples; ++j) {
+            Matrix<double, 2, Dynamic> Line;
+            const Matrix<double, Dynamic, 1> &Trapez = Radon.discretize(S(j), Line);
+
+            for (int i = 0; i < Line.cols(); ++i) {
+                int k, l;
+                double w[4];
+                sfao.stencil(Line.col(i), &k, &l, w);
+
+                const int row = n * numSamples + j;
+                const int col = k + l * gridSize; // column-major index of grid point (k,l)
+                const int offset[4] = { 0, 1, gridSize, gridSize + 1 };
+                for (int c = 0; c < 4; ++c) {
+                    if (w[c] != 0.)
+                        triplets.push_back(RadonMatrix::TripletType(row, col + offset[c],
+                                                                    Trapez(i) * w[c]));
+                }
+            }
+        }
     }
 
-private:
-    BilinearInterpol *m_func;
-};
+    A->setForward(triplets);
 
-template<class Interpol>
-class TrgtFuncAccOp
-{
-public:
-    template <typename Derived>
-    TrgtFuncAccOp(const EigenBase<Derived> &dataValues)
-    {
-        EIGEN_STATIC_ASSERT_VECTOR_ONLY(Derived); // assert if we call c'tor with a matrix
+    /* backward part:
+     * ==============
+     * Backprojection of the sample indices (counted from 1, 0 means out of bounds)
+     * tells us which sample every grid point receives. */
+    RowVectorXd Index = RowVectorXd::LinSpaced(Sequential, numSamples, 1, numSamples);
+    MatrixXd Grid(gridSize, gridSize);
+    Matrix<int, Dynamic, 1> Samples(gridSize * gridSize);
 
-        typedef typename Derived::Scalar Scalar;
+    for (int n = 0; n < angles; ++n) {
+        TrgtFuncAccOp<Projection> tfao(Index);
+        Backprojection<TrgtFuncAccOp<Projection> > R_adjoint(tfao, Sigma.col(n));
 
-        Matrix<Scalar, 1, Dynamic> X =
-                Matrix<Scalar, 1, Dynamic>::LinSpaced(Sequential, dataValues.size(),
-                                                      -1, 1);
+        backprojectGrid(R_adjoint, Xsi, 1., Grid);
 
-        m_interpol = new Interpol(X, dataValues);
+        for (int p = 0; p < Grid.size(); ++p)
+            Samples(p) = int(Grid(p)) - 1;
+        A->setBackward(n, Samples);
     }
+}
+
+/**
+ * @brief Filtered Backprojection of the data sets, used as initial value.
+ * The data sets are the squared projections, which RadonOperator weights by
+ * (m-1)/(m*L) (trapezoidal rule on m points of the line of length L). So
+ * sqrt(Y_delta) times m*L/(m-1) approximates the line integrals, which are
+ * convolved with the Ram-Lak filter (Kak & Slaney, "Principles of
+ * Computerized Tomographic Imaging", eq. 3.61) and backprojected with linear
+ * interpolation. Lines with a single point (the edge of the unit disc) are left out.
+ * @param X0 Receives the result, at least X0_C everywhere.
+ * @param config Geometry of the reconstruction.
+ * @param Sigma Recording angles, one column per angle.
+ * @param S Discrete samples of s-axis (target coord. system).
+ * @param Xsi Discrete samples of x- and y-axis (physical coord. system).
+ * @param DataSets Data sets of all recording angles.
+ */
+static void filteredBackprojection(MatrixXd *X0, const ReconstructionConfig &config,
+                                   const MatrixXd &Sigma, const RowVectorXd &S,
+                                   const RowVectorXd &Xsi, const RowVectorXd *DataSets)
+{
+    const int angles = Sigma.cols();
+    const int numSamples = S.size();
+    const int gridSize = Xsi.size();
+    const double ds = S(1) - S(0);
 
-    ~TrgtFuncAccOp()
-    { delete m_interpol; }
+    /* Scale:
+     * ======
+     * m*L/(m-1) of the line of every sample. */
+    RowVectorXd Scale(numSamples);
+    for (int j = 0; j < numSamples; ++j) {
+        double lower, upper;
+        circleBound(S(j), &lower, &upper);
+        const int m = 1 + (std::abs(lower) + std::abs(upper))/config.sampleRate;
+        Scale(j) = (m > 1) ? m * (upper - lower) / (m - 1.) : 0.;
+    }
 
-    template <typename Scalar>
-    Scalar operator()(const Scalar s) const
-    {
-        /* check out of bound, SchlierenData is only valid in [-1,1]: */
-        if ((s < -1.) || (s > 1.))
-            return Scalar(0);
+    /* Ram-Lak filter, times ds for the convolution: */
+    RowVectorXd Filter = RowVectorXd::Zero(numSamples);
+    Filter(0) = 1. / (4. * ds);
+    for (int k = 1; k < numSamples; k += 2)
+        Filter(k) = -1. / (M_PI * M_PI * k * k * ds);
+
+    X0->setZero(gridSize, gridSize);
+    MatrixXd Grid(gridSize, gridSize);
+    RowVectorXd Line(numSamples), Filtered(numSamples);
+    for (int n = 0; n < angles; ++n) {
+        Line = DataSets[n].cwiseMax(0.).cwiseSqrt().cwiseProduct(Scale);
+        for (int j = 0; j < numSamples; ++j) {
+            double sum = 0.;
+            for (int k = 0; k < numSamples; ++k)
+                sum += Filter(std::abs(j - k)) * Line(k);
+            Filtered(j) = sum;
+        }
 
-        /* get data at s:*/
-        Scalar ret = m_interpol->interpol(s);
+        TrgtFuncAccOp<LinearInterpol> tfao(Filtered);
+        Backprojection<TrgtFuncAccOp<LinearInterpol> > R_adjoint(tfao, Sigma.col(n));
 
-        return ret;
+        backprojectGrid(R_adjoint, Xsi, M_PI / angles, Grid);
+        *X0 += Grid;
     }
 
-private:
-    Interpol *m_interpol;
-};
+    *X0 = X0->cwiseMax(X0_C);
+}
+
+/**
+ * @brief Logs the time breakdown @a totals of a run as table (Info) and every
+ * phase with its counters as separate entry (Verbose).
+ */
+static void logProfile(const Profiler::Totals &totals, double wallSeconds)
+{
+    Logger::log(Logger::Info, "profile", "Time breakdown:\n" + Profiler::report(totals, wallSeconds),
+                {{"seconds", wallSeconds}, {"threads", totals.threads}});
+
+    if (!Logger::isEnabled(Logger::Verbose))
+        return;
+
+    for (int p = 0; p < Profiler::PhaseCount; ++p) {
+        const Profiler::Counters &c = totals.phase[p];
+        Logger::log(Logger::Verbose, "profile_phase", Profiler::phaseName(Profiler::Phase(p)),
+                    {{"phase", Profiler::phaseName(Profiler::Phase(p))},
+                     {"calls", double(c.calls)}, {"samples", double(c.samples)},
+                     {"seconds", c.nanoseconds * 1e-9}, {"allocations", double(c.allocations)},
+                     {"bytes", double(c.bytes)}});
+    }
+}
+
+/**
+ * @brief Row-Vector for the samples of one recording angle.
+ * Common sample counts are fixed-size, all others use a fixed buffer of
+ * ReconstructionConfig::MaxNumSamples, so no heap memory is needed.
+ */
+template <int Size, typename Scalar = double>
+using SampleVector = Matrix<Scalar, 1, Size, RowMajor, 1,
+                            (Size == Dynamic) ? ReconstructionConfig::MaxNumSamples : Size>;
 
 /**
  * @brief Class which holds the right-hand-side of our regularization formula.
+ * If a RadonMatrix is passed, it is used for all projections and backprojections
+ * instead of sampling the Radon Operator point by point.
+ * If a FourierSlice is passed, projectAll() and backprojectAll() work on all
+ * angles by FFT. The single angle functions then still sample (or use the
+ * matrix), so it only pays off for solvers which evaluate all angles at the
+ * same matrix (Euler & Nesterov).
+ *
+ * The grid data and the projections are of type @a GridScalar. With float the
+ * residuals and the errors are still computed in double, only the system matrix
+ * products run in single precision. The sampled operators always work in double.
+ *
+ * The forward projections of a matrix can be computed for all angles at once by
+ * projectAll(). The result is used by error() and backproject(), so the
+ * projections of the accepted iterate only need to be computed once.
+ *
+ * The kernels working on the samples of one angle are templates on the number
+ * of samples, the common counts 21, 41 and 81 are compiled as fixed-size.
+ *
+ * All functions take the index of an active angle, which is mapped to the
+ * recording angle by setActiveAngles(). By default all angles are active and
+ * the mapping is the identity. With streamed data sets only the angles received
+ * so far are active, in the order they arrived.
+ *
+ * Without system matrix and FourierSlice the projections are sampled. The
+ * interpolators and operators for this are created once by the constructor,
+ * one set per thread, and are refilled in place by every call.
  */
-template <typename DerivedMatrix, typename DerivedVector>
+template <typename DerivedMatrix, typename DerivedVector, typename GridScalar = double>
 class DerivateOperator
 {
     typedef typename DerivedVector::Scalar Scalar;
+    typedef Matrix<GridScalar, Dynamic, Dynamic> GridType;
 
 public:
-    DerivateOperator(const EigenBase<DerivedMatrix> &Sigma,
+    DerivateOperator(const ReconstructionConfig &config, const EigenBase<DerivedMatrix> &Sigma,
                      const EigenBase<DerivedVector> &S, const EigenBase<DerivedVector> &Xsi,
-                     const DerivedVector *DataSets)
+                     const DerivedVector *DataSets, const BasicRadonMatrix<GridScalar> *A = nullptr,
+                     FourierSlice *F = nullptr)
         : m_Sigma(Sigma.derived()),
           m_S(S.derived()),
           m_Xsi(Xsi.derived()),
-          m_DataSet(DataSets)
+          m_DataSet(DataSets),
+          m_Matrix(A),
+          m_Fourier(F),
+          m_Trapez(config.sampleRate),
+          m_l2norm(config.l2norm()),
+          m_Active(nullptr),
+          m_activeCount(config.recordingAngles)
     {
         EIGEN_STATIC_ASSERT_VECTOR_ONLY(DerivedVector);
         assert(DataSets != nullptr);
+        assert(m_S.size() == config.numSamples());
+        assert(m_Xsi.size() == config.gridSize);
+
+        if ((A == nullptr) && (F == nullptr)) {
+#ifdef _OPENMP
+            const int threads = omp_get_max_threads();
+#else
+            const int threads = 1;
+#endif
+            const VectorXd Xsi = m_Xsi.transpose();
+            const MatrixXd Grid = MatrixXd::Zero(Xsi.size(), Xsi.size());
+
+            /* the grid is equidistant, so the interpolator is stateless and can be shared: */
+            m_Interp.reset(new BilinearInterpol(Xsi, Xsi, Grid));
+            m_Sfao.reset(new SrcFuncAccOp(m_Interp.get()));
+            assert(m_Interp->isUniform());
+
+            for (int i = 0; i < threads; ++i)
+                m_Sampled.emplace_back(new SampledBuffers(Xsi, Grid, *m_Sfao, m_Trapez, m_S.size()));
+            backprojectionAxes(Xsi, m_U, m_V);
+        }
     }
 
-    template <typename Derived, typename OtherDerived>
-    void error(const EigenBase<Derived> &X, EigenBase<OtherDerived> &Error)
+    /**
+     * @brief Restricts all functions to the first @a count angles of @a active.
+     * @param active Recording angle of each active angle, @c nullptr for identity.
+     * @param count Number of active angles.
+     */
+    void setActiveAngles(const int *active, int count)
     {
-        EIGEN_STATIC_ASSERT_VECTOR_ONLY(OtherDerived);
+        m_Active = active;
+        m_activeCount = count;
+    }
 
-        constexpr int numSamples = 2/AR_TRGT_SMPL_RATE + 1;
-        constexpr double l2norm = sqrt(AR_TRGT_SMPL_RATE); // norm correction: ||x||_L2 = l2norm * ||x||_2
+    inline int activeCount() const
+    { return m_activeCount; }
 
-        BilinearInterpol interp(m_Xsi, m_Xsi, X);
-        SrcFuncAccOp sfao(&interp);
+    /**
+     * @brief Forward projections of @a X for all active angles.
+     * @param X Grid data.
+     * @param RadonAll Matrix which receives the projections, one row per active angle.
+     * @param first Index of the first active angle to project.
+     */
+    template <typename Derived, typename OtherDerived>
+    void projectAll(const EigenBase<Derived> &X, MatrixBase<OtherDerived> &RadonAll, int first = 0)
+    {
+        if (m_Fourier != nullptr) {
+            Profiler::Scope scope(Profiler::ForwardProjection, X.size());
+            m_Fourier->transform(X.derived().template cast<double>());
+            scope.stop();
+
+            #pragma omp parallel for schedule(static)
+            for (int n = first; n < m_activeCount; ++n) {
+                Profiler::Scope scope(Profiler::ForwardProjection, m_S.size());
+                SampleVector<Dynamic> RadonData(m_S.size());
+                m_Fourier->project(angle(n), RadonData.data());
+                RadonAll.row(n) = RadonData.template cast<GridScalar>();
+            }
+        } else if (m_Matrix != nullptr) {
+            #pragma omp parallel for schedule(static)
+            for (int n = first; n < m_activeCount; ++n) {
+                Profiler::Scope scope(Profiler::ForwardProjection, m_S.size());
+                auto RadonData = RadonAll.row(n);
+                m_Matrix->project(angle(n), X.derived(), RadonData);
+            }
+        } else {
+            Profiler::Scope scope(Profiler::Interpolator, X.size());
+            m_Interp->setValues(X.derived());
+            scope.stop();
+
+            #pragma omp parallel for schedule(dynamic)
+            for (int n = first; n < m_activeCount; ++n) {
+                Profiler::Scope scope(Profiler::ForwardProjection, m_S.size());
+                auto RadonData = RadonAll.row(n);
+                radon(n, sampled().SharedRadon, RadonData);
+            }
+        }
+    }
 
-        for (int n = 0; n < Error.size(); ++n) {
-            RadonOperator<SrcFuncAccOp, void (double, double *, double *)>
-                    Radon(sfao, circleBound, m_Sigma.col(n));
-                    //Radon(sfao, squareBound, m_Sigma.col(n));
+    /**
+     * @brief Calculates the error ||Y_delta - F(X)||_L2 for all active angles.
+     * @param RadonAll Forward projections of X, see projectAll().
+     * @param Error Vector which receives the error, one entry per active angle.
+     */
+    template <typename Derived, typename OtherDerived>
+    void error(const MatrixBase<Derived> &RadonAll, EigenBase<OtherDerived> &Error)
+    {
+        EIGEN_STATIC_ASSERT_VECTOR_ONLY(OtherDerived);
 
-            Matrix<double, 1, numSamples> RadonData; // temporary vector for radon data
-            for (int j = 0; j < m_S.cols(); ++j)
-                RadonData[j] = Radon(m_S.coeffRef(j));
+        #pragma omp parallel for schedule(static)
+        for (int n = 0; n < m_activeCount; ++n) {
+            Profiler::Scope scope(Profiler::ErrorEvaluation, m_S.size());
+            switch (m_S.size()) {
+            case 21:  Error.derived()[n] = errorKernel<21>(n, RadonAll.row(n));      break;
+            case 41:  Error.derived()[n] = errorKernel<41>(n, RadonAll.row(n));      break;
+            case 81:  Error.derived()[n] = errorKernel<81>(n, RadonAll.row(n));      break;
+            default:  Error.derived()[n] = errorKernel<Dynamic>(n, RadonAll.row(n)); break;
+            }
+        }
+    }
 
-            Matrix<double, 1, numSamples> SchlierenData; // temporary vector for schlieren data
-            SchlierenData = RadonData.cwiseProduct(RadonData);
+    /**
+     * @brief Calculates the right-hand-side for active angle @a n from the
+     * forward projection @a RadonData of the current matrix.
+     * @param n Index of active angle.
+     * @param RadonData Forward projection for angle @a n.
+     * @param Xout Matrix which receives the backprojected data.
+     */
+    template <typename Derived, typename OtherDerived>
+    void backproject(const int n, const MatrixBase<Derived> &RadonData, EigenBase<OtherDerived> &Xout)
+    {
+        switch (m_S.size()) {
+        case 21:  backprojectKernel<21>(n, RadonData, Xout.derived());      break;
+        case 41:  backprojectKernel<41>(n, RadonData, Xout.derived());      break;
+        case 81:  backprojectKernel<81>(n, RadonData, Xout.derived());      break;
+        default:  backprojectKernel<Dynamic>(n, RadonData, Xout.derived()); break;
+        }
+    }
 
-            Error.derived()[n] = l2norm * (m_DataSet[n] - SchlierenData).norm(); // ||Y_delta - F(Xn)||_L2
+    /**
+     * @brief Sum of the right-hand-sides of all active angles, needs a FourierSlice.
+     * @param RadonAll Forward projections of the current matrix, see projectAll().
+     * @param Xout Matrix which receives the backprojected data.
+     */
+    template <typename Derived>
+    void backprojectAll(const MatrixBase<Derived> &RadonAll, GridType &Xout)
+    {
+        assert(m_Fourier != nullptr);
+        m_Fourier->clearProjections();
+
+        #pragma omp parallel for schedule(static)
+        for (int n = 0; n < m_activeCount; ++n) {
+            Profiler::Scope scope(Profiler::Backprojection, m_S.size());
+            SampleVector<Dynamic> DiffTimesRadon(m_S.size());
+            residual<Dynamic>(n, RadonAll.row(n), DiffTimesRadon);
+            m_Fourier->setProjection(angle(n), DiffTimesRadon.data());
         }
+
+        Profiler::Scope scope(Profiler::Backprojection, Xout.size());
+        backprojectFourier(Xout);
     }
 
     template <typename Derived, typename OtherDerived>
     void operator()(const int n, const EigenBase<Derived> &Xin, EigenBase<OtherDerived> &Xout)
     {
-        constexpr int numSamples = 2/AR_TRGT_SMPL_RATE + 1;
+        switch (m_S.size()) {
+        case 21:  derivsKernel<21>(n, Xin.derived(), Xout.derived());      break;
+        case 41:  derivsKernel<41>(n, Xin.derived(), Xout.derived());      break;
+        case 81:  derivsKernel<81>(n, Xin.derived(), Xout.derived());      break;
+        default:  derivsKernel<Dynamic>(n, Xin.derived(), Xout.derived()); break;
+        }
+    }
 
-        BilinearInterpol interp(m_Xsi, m_Xsi, Xin);
-        SrcFuncAccOp sfao(&interp);
+private:
+    typedef RadonOperator<SrcFuncAccOp, void (double, double *, double *)> SampledRadon;
+
+    /* SampledBuffers:
+     * ===============
+     * Interpolator and operators of the sampled projector used by one thread.
+     * Radon works on the thread's own Interp, which derivsKernel() fills with
+     * the stage, SharedRadon on the interpolator filled by projectAll(). */
+    struct SampledBuffers
+    {
+        SampledBuffers(const VectorXd &Xsi, const MatrixXd &Grid, SrcFuncAccOp &shared,
+                       const TrapezoidalRule &trapez, int numSamples)
+            : Interp(Xsi, Xsi, Grid),
+              Sfao(&Interp),
+              Radon(Sfao, circleBound, Vector2d::UnitX(), trapez),
+              SharedRadon(shared, circleBound, Vector2d::UnitX(), trapez),
+              Tfao(RowVectorXd::Zero(numSamples))
+        {}
+
+        BilinearInterpol Interp;
+        SrcFuncAccOp Sfao;
+        SampledRadon Radon;
+        SampledRadon SharedRadon;
+        TrgtFuncAccOp<Projection> Tfao;
+    };
+
+    inline int angle(const int n) const
+    { return (m_Active != nullptr) ? m_Active[n] : n; }
+
+    inline SampledBuffers &sampled()
+    { return *m_Sampled[ODE::threadNum()]; }
+
+    /* Kernels:
+     * ========
+     * The public functions above call these templates with the number of samples
+     * as compile-time constant for the sample rates 0.1, 0.05 and 0.025. */
+    template <int Size, typename Derived>
+    double errorKernel(const int n, const MatrixBase<Derived> &RadonData)
+    {
+        SampleVector<Size> SchlierenData; // temporary vector for schlieren data
+        SchlierenData = RadonData.template cast<double>().cwiseProduct(RadonData.template cast<double>());
 
-        RadonOperator<SrcFuncAccOp, void (double, double *, double *)>
-                Radon(sfao, circleBound, m_Sigma.col(n));
-                //Radon(sfao, squareBound, m_Sigma.col(n));
+        return m_l2norm * (m_DataSet[angle(n)] - SchlierenData).norm(); // ||Y_delta - F(Xn)||_L2
+    }
+
+    template <int Size, typename Derived>
+    void residual(const int n, const MatrixBase<Derived> &RadonData, SampleVector<Size> &DiffTimesRadon)
+    {
+        SampleVector<Size> SchlierenData; // temporary vector for schlieren data
+        SchlierenData = RadonData.template cast<double>().cwiseProduct(RadonData.template cast<double>());
+
+        SampleVector<Size> Diff = m_DataSet[angle(n)] - SchlierenData; // Diff = Y_delta - F(Xn)
+        DiffTimesRadon = RadonData.template cast<double>().cwiseProduct(Diff); // DiffTimesRadon = R(Xn) * Diff
+        //LOG_MATRIX(DiffTimesRadon);
+    }
+
+    template <int Size, typename Derived>
+    void backprojectKernel(const int n, const MatrixBase<Derived> &RadonData, GridType &Xout)
+    {
+        Profiler::Scope scope(Profiler::Backprojection, Xout.size());
+
+        SampleVector<Size> DiffTimesRadon;
+        residual<Size>(n, RadonData, DiffTimesRadon);
+
+        if (m_Matrix != nullptr) {
+            SampleVector<Size, GridScalar> Proj = DiffTimesRadon.template cast<GridScalar>();
+            m_Matrix->backproject(angle(n), Proj, Xout);
+            Xout *= GridScalar(2.);
+        } else {
+            TrgtFuncAccOp<Projection> &tfao = sampled().Tfao;
+            tfao.setValues(DiffTimesRadon);
+            Backprojection<TrgtFuncAccOp<Projection> > R_adjoint(tfao, m_Sigma.col(angle(n)));
+
+            backprojectSampled(R_adjoint, Xout);
+        }
+
+        //LOG_MATRIX(Xout);
+    }
+
+    template <int Size, typename Derived>
+    void derivsKernel(const int n, const Derived &Xin, GridType &Xout)
+    {
+        SampleVector<Size, GridScalar> RadonData(m_S.size()); // temporary vector for radon data
+        if (m_Matrix != nullptr) {
+            Profiler::Scope scope(Profiler::ForwardProjection, m_S.size());
+            m_Matrix->project(angle(n), Xin, RadonData);
+        } else {
+            SampledBuffers &buffers = sampled();
+            Profiler::Scope interpScope(Profiler::Interpolator, Xin.size());
+            buffers.Interp.setValues(Xin);
+            interpScope.stop();
+
+            Profiler::Scope scope(Profiler::ForwardProjection, m_S.size());
+            radon(n, buffers.Radon, RadonData);
+        }
+
+        backprojectKernel<Size>(n, RadonData, Xout);
+    }
+
+    template <typename Derived>
+    void radon(const int n, SampledRadon &Radon, MatrixBase<Derived> &RadonData)
+    {
+        Radon.setSigma(m_Sigma.col(angle(n)));
 
-        Matrix<double, 1, numSamples> RadonData; // temporary vector for radon data
         for (int j = 0; j < m_S.cols(); ++j)
             RadonData[j] = Radon(m_S.coeffRef(j));
+    }
 
-        Matrix<double, 1, numSamples> SchlierenData; // temporary vector for schlieren data
-        SchlierenData = RadonData.cwiseProduct(RadonData);
-
-        Matrix<double, 1, numSamples> Diff = m_DataSet[n] - SchlierenData; // Diff = Y_delta - F(Xn)
-        Matrix<double, 1, numSamples> DiffTimesRadon = RadonData.cwiseProduct(Diff); // DiffTimesRadon = R(Xn) * Diff
-        //STDOUT_MATRIX(DiffTimesRadon);
-
-        TrgtFuncAccOp<Projection> tfao(DiffTimesRadon);
-        Backprojection<TrgtFuncAccOp<Projection> > R_adjoint(tfao, m_Sigma.col(n));
-
-        //Matrix<double, Dynamic, Dynamic> Xout(ASYMREG_GRID_SIZE, ASYMREG_GRID_SIZE); // temporary matrix for backprojected data
-        Xout.derived().setZero(ASYMREG_GRID_SIZE, ASYMREG_GRID_SIZE);
-        for (int k = 0; k < ASYMREG_GRID_SIZE; ++k) {
-            for (int l = 0; l < ASYMREG_GRID_SIZE; ++l) {
-                Matrix<double, 2, 1> vec;
-                vec << m_Xsi(k), m_Xsi(l);
-
-                /* trInv:
-                 * ======
-                 * Inverse coordinate transformation from target coord. system
-                 * (r,s) \in [0,1]^2 to physical coord. system (x,y) = [0,10]^2
-                 * We want: tr(r,s) = (x,y)|T = [2,8]^2  for r,s=0,...,1
-                 *  => tr(r,s) = (3*r+5, 3*s+5)
-                 *  => trInv(x,y) = tr.inverse()(x,y) = (0.333*[x-5], 0.333*[y-5])
-                 *
-                 * Todo: documents want (r,s) = D^1  (unit disc)
-                 */
-                static Transform<Scalar, 2, Affine> trInv = (Translation2d(5, 5) * Scaling(5.0)).inverse();
-                //STDOUT_MATRIX(trInv);
-
-                /* translate s to target coord. system: */
-                vec = trInv * vec;
-
-                /* backproject vector: */
-                Xout.derived()(k,l) = 2. * R_adjoint(vec);
-            }
-        }
+    /* backprojectSampled:
+     * ===================
+     * backprojectGrid() fills double grids only, a float grid receives a copy. */
+    template <typename Func>
+    void backprojectSampled(Backprojection<Func> &R_adjoint, MatrixXd &Xout)
+    { backprojectGrid(R_adjoint, m_U, m_V, 2., Xout); }
 
-        //STDOUT_MATRIX(Xout);
+    template <typename Func>
+    void backprojectSampled(Backprojection<Func> &R_adjoint, MatrixXf &Xout)
+    {
+        MatrixXd Grid;
+        backprojectGrid(R_adjoint, m_U, m_V, 2., Grid);
+        Xout = Grid.cast<float>();
+    }
+
+    /* backprojectFourier:
+     * ===================
+     * Same as backprojectSampled() for the FourierSlice of all angles. */
+    void backprojectFourier(MatrixXd &Xout)
+    {
+        m_Fourier->backprojectAll(Xout);
+        Xout *= 2.;
+    }
+
+    void backprojectFourier(MatrixXf &Xout)
+    {
+        MatrixXd Grid;
+        m_Fourier->backprojectAll(Grid);
+        Xout = 2.f * Grid.cast<float>();
     }
 
-private:
     const DerivedMatrix &m_Sigma;
     const DerivedVector &m_S;
     const DerivedVector &m_Xsi;
     const DerivedVector *m_DataSet;
+    const BasicRadonMatrix<GridScalar> *m_Matrix;
+    FourierSlice *m_Fourier;
+    const TrapezoidalRule m_Trapez;
+    const double m_l2norm;
+    const int *m_Active;
+    int m_activeCount;
+    std::unique_ptr<BilinearInterpol> m_Interp; // sampled projector: grid of projectAll()
+    std::unique_ptr<SrcFuncAccOp> m_Sfao;
+    std::vector<std::unique_ptr<SampledBuffers> > m_Sampled; // one per thread
+    VectorXd m_U, m_V; // grid axes of backprojectGrid()
 };
 
-// init static members:
-BilinearInterpol *AsymReg::m_sourceFunc(nullptr);
-RowVectorXd AsymReg::m_DataSet[AR_NUM_REC_ANGL];
-Matrix<double, Dynamic, Dynamic> AsymReg::m_Result;
+/**
+ * @brief Returns false if a parallel region runs on a single thread, libgomp
+ * allocates the team of every such region.
+ */
+static inline bool parallelTeamsCached()
+{
+#ifdef _OPENMP
+    return (omp_get_max_threads() > 1);
+#else
+    return true;
+#endif
+}
 
 // function implementations:
-void circleBound(double in, double *lower, double *upper)
+AsymRegEngine::AsymRegEngine()
+    : m_sourceFunc(nullptr),
+      m_precision(DoublePrecision),
+      m_initialGuess(ConstantGuess),
+      m_stream(nullptr),
+      m_Workspace(new RegularizationWorkspace<double>),
+      m_WorkspaceF(new RegularizationWorkspace<float>),
+      m_CheckpointWriter(nullptr),
+      m_checkpointInterval(1),
+      m_Resume(nullptr),
+      m_allocations(0),
+      m_level(0),
+      m_cancel(false)
+{
+}
+
+AsymRegEngine::~AsymRegEngine()
+{
+    delete m_sourceFunc;
+    delete m_Workspace;
+    delete m_WorkspaceF;
+    delete m_CheckpointWriter; // writes the last checkpoint first
+}
+
+/**
+ * @brief Creates the source function by interpolating @a srcDat.
+ * The data is copied into the interpolator, so @a srcDat may be a Map of a
+ * file which is closed afterwards.
+ */
+void AsymRegEngine::createSourceFunction(const Ref<const MatrixXd> &srcDat)
+{
+    VectorXd xVec = VectorXd::LinSpaced(srcDat.rows(), 0., 10.);
+    VectorXd yVec = VectorXd::LinSpaced(srcDat.cols(), 0., 10.);
+
+    auto func = new BilinearInterpol(xVec, yVec, srcDat);
+    setSourceFunction(func);
+}
+
+/**
+ * @brief Creates the source function by interpolating @a srcDat in place.
+ * The data is not copied, @a owner keeps it alive as long as the source
+ * function is used, e.g. a shared MappedMatrixFile of a *.armx file.
+ */
+void AsymRegEngine::createSourceFunction(const Map<const MatrixXd> &srcDat,
+                                         const std::shared_ptr<const void> &owner)
+{
+    VectorXd xVec = VectorXd::LinSpaced(srcDat.rows(), 0., 10.);
+    VectorXd yVec = VectorXd::LinSpaced(srcDat.cols(), 0., 10.);
+
+    auto func = new BilinearInterpol(xVec, yVec, srcDat, owner);
+    setSourceFunction(func);
+}
+
+/**
+ * @brief Replaces the data sets, e.g. by the ones of another engine.
+ * The data sets have to fit the configuration passed to regularize().
+ */
+void AsymRegEngine::setDataSet(const std::vector<RowVectorXd> &dataSet)
+{
+    m_DataSet = dataSet;
+}
+
+/**
+ * @brief Assembles the Radon System Matrix for @a config.
+ * The matrix is immutable, so it can be shared by several engines (see
+ * setSystemMatrix()) which run the same geometry.
+ */
+std::shared_ptr<const RadonMatrix> AsymRegEngine::createSystemMatrix(const ReconstructionConfig &config)
+{
+    assert(config.isValid());
+
+    MatrixXd Sigma;
+    RowVectorXd S, Xsi;
+    createGeometry(config, &Sigma, &S, &Xsi);
+
+    auto A = std::make_shared<RadonMatrix>(config.recordingAngles, config.numSamples(), config.gridSize);
+    assembleRadonMatrix(A.get(), config, Sigma, S, Xsi);
+
+    return A;
+}
+
+/**
+ * @brief Sets a Radon System Matrix created by createSystemMatrix().
+ * regularize() uses it instead of assembling its own, if the geometry fits.
+ */
+void AsymRegEngine::setSystemMatrix(const std::shared_ptr<const RadonMatrix> &A)
 {
-    double val = sqrt(1 - in*in);
-    *lower = -val;
-    *upper =  val;
+    m_SystemMatrix = A;
 }
 
 /**
- * @brief Returns [-1,1] as integration boundaries for Radon-Transform.
- * @param in (unused)
- * @param lower Pointer to lower boundary variable.
- * @param upper Pointer to upper boundary variable.
+ * @brief Sets a single precision Radon System Matrix, e.g. a cast of the one
+ * created by createSystemMatrix(). It is used with SinglePrecision only.
  */
-void squareBound(double /*in*/, double *lower, double *upper)
+void AsymRegEngine::setSystemMatrix(const std::shared_ptr<const RadonMatrixf> &A)
 {
-    *lower = -1.;
-    *upper = 1.;
+    m_SystemMatrixF = A;
 }
 
-void AsymReg::createSourceFunction(const MatrixXd &srcDat)
+template <>
+RegularizationWorkspace<double> &AsymRegEngine::workspace<double>()
 {
-    VectorXd xVec = VectorXd::LinSpaced(ASYMREG_DATSRC_SIZE, 0., 10.);
+    return *m_Workspace;
+}
 
-    auto func = new BilinearInterpol(xVec, xVec, srcDat);
-    AsymReg::setSourceFunction(func);
+template <>
+RegularizationWorkspace<float> &AsymRegEngine::workspace<float>()
+{
+    return *m_WorkspaceF;
 }
 
-void AsymReg::generateDataSet(int recordingAngles, double delta, Duration *time)
+/**
+ * @brief Returns @a A with coefficients of type @a GridScalar, a double
+ * matrix is passed through.
+ */
+template <typename GridScalar>
+static std::shared_ptr<const BasicRadonMatrix<GridScalar> > castSystemMatrix(const std::shared_ptr<const RadonMatrix> &A)
+{
+    return std::make_shared<BasicRadonMatrix<GridScalar> >(A->template cast<GridScalar>());
+}
+
+template <>
+std::shared_ptr<const RadonMatrix> castSystemMatrix<double>(const std::shared_ptr<const RadonMatrix> &A)
+{
+    return A;
+}
+
+template <typename GridScalar>
+static bool fitsGeometry(const std::shared_ptr<const BasicRadonMatrix<GridScalar> > &A,
+                         const ReconstructionConfig &config)
+{
+    return A && (A->angles() == config.recordingAngles)
+             && (A->numSamples() == config.numSamples())
+             && (A->gridSize() == config.gridSize);
+}
+
+/**
+ * @brief Returns the shared Radon System Matrix if it fits the geometry of
+ * @a config, otherwise @c nullptr.
+ */
+template <>
+std::shared_ptr<const RadonMatrix> AsymRegEngine::systemMatrix<double>(const ReconstructionConfig &config)
+{
+    return fitsGeometry(m_SystemMatrix, config) ? m_SystemMatrix : nullptr;
+}
+
+/**
+ * @brief Single precision version, a fitting double matrix is cast as well.
+ */
+template <>
+std::shared_ptr<const RadonMatrixf> AsymRegEngine::systemMatrix<float>(const ReconstructionConfig &config)
+{
+    if (fitsGeometry(m_SystemMatrixF, config))
+        return m_SystemMatrixF;
+    if (fitsGeometry(m_SystemMatrix, config))
+        return castSystemMatrix<float>(m_SystemMatrix);
+    return nullptr;
+}
+
+/**
+ * @brief Lets regularize() take the data sets from @a stream instead.
+ * The regularization starts as soon as the first projection has arrived and
+ * includes further ones between two iterations. The stream is not owned by
+ * the engine, pass @c nullptr to use the data sets of generateDataSet() again.
+ */
+void AsymRegEngine::setDataSetStream(DataSetStream *stream)
+{
+    m_stream = stream;
+}
+
+void AsymRegEngine::setProgressCallback(const ProgressCallback &callback)
+{
+    m_progress = callback;
+}
+
+/**
+ * @brief Seeds the random generator used for the data pertubation in
+ * generateDataSet(), so a run can be reproduced.
+ */
+void AsymRegEngine::setRandomSeed(unsigned int seed)
+{
+    m_Random.seed(seed);
+}
+
+void AsymRegEngine::generateDataSet(const ReconstructionConfig &config, double delta, Duration *time)
 {
     typedef typename MatrixXd::Index Index;
 
-    const int angles = (recordingAngles > 0) ? recordingAngles : N;
+    assert(config.isValid()); // also checks for even number of angles and uneven number of samples
+
+    const int angles = config.recordingAngles;
 
     /* Phi:
      * ====
@@ -277,16 +809,18 @@ void AsymReg::generateDataSet(int recordingAngles, double delta, Duration *time)
      * We could use intervall [0,pi) but we will then never get the exact 90°
      * angle which means data sampling in direction of light-rays/xray.
      */
-    assert(angles % 2 == 0); // only even numbers of angles are allowed, we want that 90° angle
     ArrayXd Phi = ArrayXd::LinSpaced(Sequential, angles+1, 0., M_PI).head(angles); // head(N) => take only first N entries
 
-    /* printing list of rec. angles to stdout: */
-    std::cout << "Using the following " << angles << " recording angels:" << std::endl
-              << (Phi*PHI/M_PI).format(IOFormat(2, 0, "", "°, ", "", "", "", "°")) // comma-separated list
-                                                                                   // and '°' after each number
-              << std::endl << std::endl;
+    /* logging list of rec. angles: */
+    if (Logger::isEnabled(Logger::Verbose)) {
+        std::ostringstream os;
+        os << "Using the following " << angles << " recording angels:" << std::endl
+           << (Phi*PHI/M_PI).format(IOFormat(2, 0, "", "°, ", "", "", "", "°")); // comma-separated list
+                                                                               // and '°' after each number
+        Logger::log(Logger::Verbose, "angles", os.str(), {{"angles", angles}});
+    }
 
-    auto t1 = hrc::now(); // Start timing (TODO: start before Phi, but exlude cout)
+    auto t1 = hrc::now(); // Start timing (TODO: start before Phi, but exlude logging)
     /* Sigma:
      * ======
      * Recording angles Phi in euclidian coord. system.
@@ -296,17 +830,15 @@ void AsymReg::generateDataSet(int recordingAngles, double delta, Duration *time)
     Sigma.row(0) = Phi.cos(); // [cos(phi_0), cos(phi_1), ... , cos(phi_n)]
     Sigma.row(1) = Phi.sin(); // [sin(phi_0), sin(phi_1), ... , sin(phi_n)]
 
-    const Index numSamples = 2/AR_TRGT_SMPL_RATE + 1;
-    static_assert(numSamples % 2, "only values for AR_TRGT_SMPL_RATE with uneven"
-                                  "result of \"(2/AR_TRGT_SMPL_RATE) + 1\" are allowed");
-    constexpr double l2norm = sqrt(AR_TRGT_SMPL_RATE);
+    const Index numSamples = config.numSamples();
+    const double l2norm = config.l2norm();
 
     /* S:
      * ==
      * Discrete samples of s-axis (target coord. system)
-     * The basis for this sampling is the value defined in AR_TRGT_SMPL_RATE
+     * The basis for this sampling is the sample rate of the configuration
      * S_i = -1 + i * numsamples, for i=0,1,2,... , and
-     * where numsamples = (2/AR_TRGT_SMPL_RATE) + 1
+     * where numsamples = (2/sampleRate) + 1
      *
      * TODO: use grid size (like Plotter) as calculation basis
      */
@@ -314,11 +846,16 @@ void AsymReg::generateDataSet(int recordingAngles, double delta, Duration *time)
 
     //std::cout << "S =" << std::endl << S << std::endl << std::endl;
 
+    TrapezoidalRule trapez(config.sampleRate); // coefficients for all RadonOperators
+    std::uniform_real_distribution<double> uniform(-1., 1.);
+
+    m_DataSet.resize(angles);
+
     /* iterate over all rec. angles: */
     for (Index n = 0; n < angles; ++n) {
         //std::cout << std::endl << "phi_" << n << " = " << (Phi(n)*PHI/M_PI) << std::endl;
 
-        Array<double, 1, numSamples> Integral; // temporary vector for integrated data
+        Array<double, 1, Dynamic> Integral(numSamples); // temporary vector for integrated data
 
         /* Radon:
          * ======
@@ -330,8 +867,8 @@ void AsymReg::generateDataSet(int recordingAngles, double delta, Duration *time)
          */
         SrcFuncAccOp sfao(sourceFunction());
         RadonOperator<SrcFuncAccOp, void (double, double *, double *)>
-                Radon(sfao, circleBound, Sigma.col(n));
-                //Radon(sfao, squareBound, Sigma.col(n));
+                Radon(sfao, circleBound, Sigma.col(n), trapez);
+                //Radon(sfao, squareBound, Sigma.col(n), trapez);
 
         /* iterate over all entries in vector S: */
         for (Index j = 0; j < numSamples; ++j)
@@ -341,9 +878,11 @@ void AsymReg::generateDataSet(int recordingAngles, double delta, Duration *time)
         m_DataSet[n] = Integral.square();
         RowVectorXd yd = m_DataSet[n];
 
-        /* create random unit vector for data pertubation: */
+        /* create random unit vector for data pertubation (engine's own generator): */
         if (delta > 0.0) {
-            RowVectorXd Rand = RowVectorXd::Random(2/AR_TRGT_SMPL_RATE + 1);
+            RowVectorXd Rand(numSamples);
+            for (Index j = 0; j < numSamples; ++j)
+                Rand(j) = uniform(m_Random);
             //RowVectorXd RandN = Rand.normalized() * l2norm;
             m_DataSet[n] += (delta / l2norm) * Rand.normalized();
             //double diff = (m_DataSet[n] - yd).norm() * l2norm;
@@ -352,31 +891,68 @@ void AsymReg::generateDataSet(int recordingAngles, double delta, Duration *time)
     }
     auto t2 = hrc::now(); // Stop timing
 
-    /* printing generated data y_n to stdout: */
-    std::cout << "Resulting in the following disturbed (delta =" << DELTA << ") data:" << std::endl;
-    for (Index n = 0; n < angles; ++n) {
-        std::cout << "y_" << n << "(s) =" << std::endl
-                  << m_DataSet[n] << std::endl
-                  << std::endl;
+    /* logging generated data y_n (bulk output, formatting takes its time): */
+    if (Logger::isEnabled(Logger::Debug)) {
+        std::ostringstream os;
+        os << "Resulting in the following disturbed (delta =" << delta << ") data:" << std::endl;
+        for (Index n = 0; n < angles; ++n) {
+            os << "y_" << n << "(s) =" << std::endl
+               << m_DataSet[n] << std::endl;
+        }
+        Logger::log(Logger::Debug, "dataset", os.str());
     }
 
-    std::cout << std::endl;
+    Duration dt(t2 - t1);
+    Logger::log(Logger::Info, "timing", "Data sets generated in " + dt.toString(),
+                {{"stage", "datasets"}, {"seconds", dt.seconds()}, {"angles", angles}, {"delta", delta}});
 
     if (time != nullptr)
-        *time = t2 - t1;
+        *time = dt;
 }
 
-double AsymReg::regularize(int recordingAngles, double delta,
+double AsymRegEngine::regularize(const ReconstructionConfig &config, double delta,
                            ODE_Solver solver, int iterations, double step,
-                           const PlotterSettings *pl, Duration *time)
+                           const PlotterSettings *pl, Duration *time,
+                           Projector projector)
 {
-    typedef typename MatrixXd::Index Index;
-    typedef typename MatrixXd::Scalar Scalar;
+    if (m_precision == SinglePrecision) {
+        if (projector == SystemMatrixProjector)
+            return regularizeWith<float>(config, delta, solver, iterations, step, pl, time, projector);
+
+        Logger::log(Logger::Verbose, "setup", "Single precision needs the Radon system matrix, "
+                    "using double precision");
+    }
+
+    return regularizeWith<double>(config, delta, solver, iterations, step, pl, time, projector);
+}
+
+/**
+ * @brief Implementation of regularize() with grid data of type @a GridScalar.
+ */
+template <typename GridScalar>
+double AsymRegEngine::regularizeWith(const ReconstructionConfig &config, double delta,
+                                     ODE_Solver solver, int iterations, double step,
+                                     const PlotterSettings *pl, Duration *time,
+                                     Projector projector)
+{
+    typedef Matrix<GridScalar, Dynamic, Dynamic> GridType;
+    typedef typename GridType::Index Index;
 
     m_Result.setZero();
 
-    const double h      = (step > 0.)           ? step            : H;
-    const int    angles = (recordingAngles > 0) ? recordingAngles : N;
+    assert(config.isValid());
+
+    const double h        = (step > 0.) ? step : H;
+    const int    angles   = config.recordingAngles;
+    const int    gridSize = config.gridSize;
+
+    /* data sets have to be generated (or streamed) with the same geometry: */
+    if (m_stream != nullptr) {
+        assert((m_stream->angles() == angles) && (m_stream->numSamples() == config.numSamples()));
+        m_DataSet.assign(angles, RowVectorXd()); // filled as projections arrive
+    } else {
+        assert((int(m_DataSet.size()) == angles) && (m_DataSet[0].size() == config.numSamples()));
+    }
 
     /* prepare plotter settings: */
     ContourPlotterSettings *sett = nullptr;
@@ -386,141 +962,647 @@ double AsymReg::regularize(int recordingAngles, double delta,
         sett->setTitle("regularized data", 2);
     }
 
-    std::cout << "Solving ODE with ";
-
+    const char *solverName = "";
     switch (solver) {
     case Euler:
-        std::cout << "Euler (direct)";
+        solverName = "Euler (direct)";
         break;
     case Midpoint:
-        std::cout << "Midpoint (2nd order)";
+        solverName = "Midpoint (2nd order)";
         break;
     case RungeKutta:
-        std::cout << "Runge Kutta (4th order)";
+        solverName = "Runge Kutta (4th order)";
+        break;
+    case BogackiShampine:
+        solverName = "Bogacki-Shampine (adaptive 3rd order)";
         break;
+    case Nesterov:
+        solverName = "Nesterov (accelerated Landweber)";
+        break;
+    }
+
+    if (Logger::isEnabled(Logger::Verbose)) {
+        std::ostringstream os;
+        os << "Solving ODE with " << solverName << " method:" << std::endl
+           << "  -> step size h = " << h << std::endl
+           << "  -> precision: " << ((sizeof(GridScalar) == sizeof(float)) ? "single" : "double") << std::endl
+           << "  -> initial value X0 = ";
+        if (m_initialGuess == FilteredBackprojectionGuess)
+            os << "filtered backprojection (at least " << X0_C << ")";
+        else
+            os << X0_C;
+        os << " matrix of R^[" << gridSize << "x" << gridSize << "]";
+        Logger::log(Logger::Verbose, "setup", os.str(),
+                    {{"solver", solverName}, {"step", h}, {"grid", gridSize},
+                     {"angles", angles}, {"delta", delta}});
     }
 
-    std::cout << " method:" << std::endl
-              << "  -> step size h = " << h << std::endl
-              << "  -> initial value X0 = " << X0_C
-              << " matrix of R^[" << ASYMREG_GRID_SIZE << "x" << ASYMREG_GRID_SIZE << "]"
-              << std::endl;
+    const Profiler::Totals profile = Profiler::isEnabled() ? Profiler::totals() : Profiler::Totals();
 
     auto t1 = hrc::now(); // Start timing
-    Matrix<double, Dynamic, Dynamic> Xdot(ASYMREG_GRID_SIZE, ASYMREG_GRID_SIZE);
-    Xdot.setZero();
-    //STDOUT_MATRIX(Xdot);
+    MatrixXd Sigma;
+    RowVectorXd S, Xsi;
+    createGeometry(config, &Sigma, &S, &Xsi);
 
-    Matrix<double, Dynamic, Dynamic> Xn(ASYMREG_GRID_SIZE, ASYMREG_GRID_SIZE);
-    Matrix<double, Dynamic, Dynamic> Noise
-            = Matrix<double, Dynamic, Dynamic>::Ones(ASYMREG_GRID_SIZE, ASYMREG_GRID_SIZE);
-            //= Matrix<double, Dynamic, Dynamic>::Random(ASYMREG_GRID_SIZE, ASYMREG_GRID_SIZE);
-    //STDOUT_MATRIX(Noise);
+    const Index numSamples = config.numSamples();
 
-    //Xn = sourceFunctionPlotData()  + 0.1 * Noise; // this is easy!
-    Xn = X0_C * Noise;                              // this one is hard!
-    //STDOUT_MATRIX(Xn);
+    /* workspace:
+     * ==========
+     * Holds all buffers of the solver, so the iterations below do not need
+     * to allocate any memory. */
+    RegularizationWorkspace<GridScalar> &ws = workspace<GridScalar>();
+    ws.resize(angles, numSamples, gridSize);
 
-    Matrix<double, 1, Dynamic> Xsi = Matrix<double, 1, Dynamic>::LinSpaced(
-                Sequential, ASYMREG_GRID_SIZE, 0., 10.);
+    GridType &Xdot = ws.Xdot;
+    Xdot.setZero();
+    //LOG_MATRIX(Xdot);
+
+    GridType &Xn = ws.Xn;
+    //Xn = sourceFunctionPlotData().array() + 0.1; // this is easy!
+    const bool fbp = (m_initialGuess == FilteredBackprojectionGuess);
+    const Checkpoint *resumed = m_Resume; // set by resume() only
+    if (resumed != nullptr) {
+        Xn = resumed->Xn.cast<GridScalar>();       // where the run was stopped
+    } else if ((m_InitialValue.rows() == gridSize) && (m_InitialValue.cols() == gridSize)) {
+        Xn = m_InitialValue.cast<GridScalar>();    // e.g. from a coarser grid
+    } else if (fbp && (m_stream == nullptr)) {
+        auto t3 = hrc::now();
+        MatrixXd X0;
+        filteredBackprojection(&X0, config, Sigma, S, Xsi, &m_DataSet[0]);
+        Xn = X0.cast<GridScalar>();                // this is close!
+        Duration dt(hrc::now() - t3);
+
+        Logger::log(Logger::Info, "timing", "  -> initial value by filtered backprojection ("
+                    + dt.toString() + ")",
+                    {{"stage", "initialvalue"}, {"seconds", dt.seconds()}});
+    } else {
+        if (fbp)
+            Logger::log(Logger::Verbose, "setup", "Filtered backprojection needs all data sets, "
+                        "using constant initial value");
+        Xn.setConstant(X0_C);                      // this one is hard!
+    }
+    //LOG_MATRIX(Xn);
 
-    ArrayXd Phi = ArrayXd::LinSpaced(Sequential, angles+1, 0., M_PI).head(angles); // head(N) => take only first N entries
-    MatrixXd Sigma(2, angles);
-    Sigma.row(0) = Phi.cos(); // [cos(phi_0), cos(phi_1), ... , cos(phi_n)]
-    Sigma.row(1) = Phi.sin(); // [sin(phi_0), sin(phi_1), ... , sin(phi_n)]
+    /* A:
+     * ==
+     * Radon System Matrix (optional).
+     * Geometry does not change during the iterations, so forward projection and
+     * backprojection are assembled once and later applied as sparse products.
+     * A matrix set by setSystemMatrix() is used if it fits the geometry.
+     * It is assembled in double and cast for single precision.
+     */
+    std::shared_ptr<const BasicRadonMatrix<GridScalar> > A;
+    if (projector == SystemMatrixProjector) {
+        A = systemMatrix<GridScalar>(config);
+        if (A) {
+            Logger::log(Logger::Verbose, "setup", "  -> using shared Radon system matrix");
+        } else {
+            auto t3 = hrc::now();
+            std::shared_ptr<const RadonMatrix> Ad = createSystemMatrix(config);
+            A = castSystemMatrix<GridScalar>(Ad);
+            Duration dt(hrc::now() - t3);
+
+            Logger::log(Logger::Info, "timing", "  -> using Radon system matrix (assembled in "
+                        + dt.toString() + ")",
+                        {{"stage", "systemmatrix"}, {"seconds", dt.seconds()}});
+        }
+    }
 
-    const Index numSamples = 2/AR_TRGT_SMPL_RATE + 1;
-    RowVectorXd S = VectorXd::LinSpaced(Sequential, numSamples, -1., 1.);
+    /* fourier:
+     * ========
+     * Fourier slice backend (optional), projects and backprojects all angles
+     * by one 2D FFT each. The other solvers evaluate every angle at its own
+     * stage values, so they sample instead.
+     * Tolerance: compared with RadonMatrix the projections of smooth data differ
+     * by about 0.2% (relative L2 norm, 1.6% for a constant disc, whose edge is
+     * not band-limited), the Backprojections of all angles by about 1.3%.
+     * The reconstruction (300x300 grid, 100 angles) differs from the sampled
+     * one by 0.75% and needs the same number of iterations.
+     */
+    std::unique_ptr<FourierSlice> fourier;
+    if (projector == FourierProjector) {
+        if ((solver == Euler) || (solver == Nesterov)) {
+            auto t3 = hrc::now();
+            fourier.reset(new FourierSlice(Sigma, S, gridSize, config.sampleRate));
+            Duration dt(hrc::now() - t3);
+
+            Logger::log(Logger::Info, "timing", "  -> using Fourier slice projector (prepared in "
+                        + dt.toString() + ")",
+                        {{"stage", "fourierslice"}, {"seconds", dt.seconds()}});
+        } else {
+            Logger::log(Logger::Verbose, "setup", std::string("Fourier slice projector needs "
+                        "Euler or Nesterov, sampling for ") + solverName);
+        }
+    }
 
-    RowVectorXd Error(angles);
+    RowVectorXd &Error = ws.Error;
     Error.setConstant(-1.0);
 
+    std::vector<GridType> &dXdt = ws.dXdt;
+    ODE::Stages<GridType> *stages = &ws.stages[0];
+
+    DerivateOperator<MatrixXd, RowVectorXd, GridScalar> derivs(config, Sigma, S, Xsi, &m_DataSet[0], A.get(),
+                                                                fourier.get());
+
+    /* streamed data sets:
+     * ===================
+     * Only angles with data are active, new ones are appended between two
+     * iterations and need the forward projection of Xn once. */
+    int momentum = 0; // Nesterov: number of steps since the last restart
+
+    std::vector<int> active;
+    std::vector<DataSetStream::Projection> arrived;
+    auto takeProjections = [&](int waitMsec) {
+        if (!m_stream->take(&arrived, waitMsec))
+            return;
+
+        const int first = active.size();
+        momentum = 0; // projections of Xprev are unknown for new angles
+        for (auto &p : arrived) {
+            if (m_DataSet[p.first].size() == 0)
+                active.push_back(p.first);
+            m_DataSet[p.first].swap(p.second); // a resent projection replaces the old one
+        }
+
+        derivs.setActiveAngles(active.data(), active.size());
+        derivs.projectAll(Xn, ws.RadonXn, first);
+
+        Logger::log(Logger::Verbose, "stream", "Received " + std::to_string(arrived.size())
+                    + " projections, " + std::to_string(active.size()) + " of "
+                    + std::to_string(angles) + " angles active",
+                    {{"received", int(arrived.size())}, {"active", int(active.size())}});
+    };
+
+    if (m_stream != nullptr) {
+        active.reserve(angles);
+        derivs.setActiveAngles(active.data(), 0);
+        while (active.empty() && !m_stream->isClosed() && !m_cancel)
+            takeProjections(100);
+
+        if (active.empty()) {
+            Logger::log(Logger::Error, "stream", "No projections received! Stopping now!!!");
+            delete sett;
+            m_Result = Xn.template cast<double>();
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+    } else {
+        /* forward projections of Xn, later on they are taken over from Xdot: */
+        derivs.projectAll(Xn, ws.RadonXn);
+    }
+
+    /* heap allocations of one iteration (we do not count the first one and
+     * ones with rejected steps): */
+    unsigned long long allocations = 0;
+    unsigned long long threadAllocations = 0; // of this thread only
+    m_allocations = 0;
+
+    /* adaptive step size, starts with h and changes from step to step: */
+    double hAdaptive = h;
+    int rejected = 0;
+
     int run = 0;
     int max = (iterations > 0) ? iterations : T;
-    do {
-        DerivateOperator<MatrixXd, RowVectorXd> derivs(Sigma, S, Xsi, &m_DataSet[0]);
-        Matrix<double , Dynamic, Dynamic> dXdt[angles];
 
-        for (int n = 0; n < angles; ++n) {
-            dXdt[n].resizeLike(Xn);
+    m_ErrorHistory.clear();
+    m_ErrorHistory.reserve(max);
+
+    /* resume:
+     * =======
+     * Continue with the state of the checkpoint, the forward projections are
+     * the same as the ones of the interrupted run. */
+    if (resumed != nullptr) {
+        run = resumed->iteration;
+        momentum = resumed->momentum;
+        hAdaptive = resumed->hAdaptive;
+        rejected = resumed->rejected;
+        m_ErrorHistory = resumed->errors;
+        if (momentum > 0) {
+            ws.Xprev = resumed->Xprev.cast<GridScalar>();
+            derivs.projectAll(ws.Xprev, ws.RadonXprev);
+        }
+    }
+    const int firstRun = run;
+
+    /* checkpoints:
+     * ============
+     * The state after an iteration is copied into a snapshot, which is
+     * written by the thread of CheckpointWriter. submit() recycles the
+     * snapshots, so after the first few filling one does not allocate memory
+     * (the writer thread does, it is included in the allocation count). */
+    CheckpointWriter *checkpoints = (m_stream == nullptr) ? m_CheckpointWriter : nullptr;
+    if ((m_CheckpointWriter != nullptr) && (checkpoints == nullptr))
+        Logger::log(Logger::Verbose, "setup", "Checkpoints need all data sets, none are written");
+
+    Checkpoint snapshot;
+    std::string randomState;
+    if (checkpoints != nullptr) {
+        std::ostringstream os;
+        os << m_Random; // not used by regularize()
+        randomState = os.str();
+    }
 
-            derivs(n, Xn, dXdt[n]);
-            //STDOUT_MATRIX(dXdt);
+    do {
+        if (m_stream != nullptr)
+            takeProjections(0); // fold in what arrived meanwhile
+
+        unsigned long long allocs = AllocationCounter::allocations();
+        unsigned long long threadAllocs = AllocationCounter::threadAllocations();
+        const int rejectedBefore = rejected;
+        double hAccepted = 0., acceptedErr = 0.;
+        const int activeAngles = derivs.activeCount();
+
+        /* Nesterov:
+         * =========
+         * The gradient is taken at Z = Xn + beta * (Xn - Xprev), which is
+         * stored in Xprev. The Radon Transform is linear, so the projections
+         * of Z are extrapolated alike and need no forward projection. */
+        const bool nesterov = (solver == Nesterov);
+        if (nesterov) {
+            auto RadonXn = ws.RadonXn.topRows(activeAngles);
+            auto RadonZ = ws.RadonXprev.topRows(activeAngles);
+            if (momentum == 0) { // (re)start: Z = Xn
+                ws.Xprev = Xn;
+                RadonZ = RadonXn;
+            } else {
+                const GridScalar beta = momentum / (momentum + 3.);
+                ws.Xprev = Xn + beta * (Xn - ws.Xprev);
+                RadonZ = RadonXn + beta * (RadonXn - RadonZ);
+            }
         }
+        const GridType &Xeval = nesterov ? ws.Xprev : Xn;
+        const auto &RadonXeval = nesterov ? ws.RadonXprev : ws.RadonXn;
+
+        /* K1 of all angles, taken from the forward projections of Xeval.
+         * The Fourier slice backend sums them up already, so the solver
+         * below gets a single increment and the step divided by the angles: */
+        const int increments = fourier ? 1 : activeAngles;
+        const GridScalar hStep = fourier ? h / activeAngles : h;
+        auto backprojectAll = [&]() {
+            if (fourier) {
+                derivs.backprojectAll(RadonXeval.topRows(activeAngles), dXdt[0]);
+                return;
+            }
+
+            #pragma omp parallel for schedule(dynamic)
+            for (int n = 0; n < activeAngles; ++n) {
+                derivs.backproject(n, RadonXeval.row(n), dXdt[n]);
+                //LOG_MATRIX(dXdt);
+            }
+        };
+        backprojectAll();
 
         switch (solver) {
         case Euler:
-            ODE::euler(angles, Xn, &dXdt[0], h, Xdot, derivs);
+            ODE::euler(increments, Xn, &dXdt[0], hStep, Xdot, derivs, stages);
+            break;
+        case Nesterov:
+            ODE::euler(increments, Xeval, &dXdt[0], hStep, Xdot, derivs, stages);
             break;
         case Midpoint:
-            ODE::rk2(angles, Xn, &dXdt[0], h, Xdot, derivs);
+            ODE::rk2(activeAngles, Xn, &dXdt[0], h, Xdot, derivs, stages);
             break;
         case RungeKutta:
-            ODE::rk4(angles, Xn, &dXdt[0], h, Xdot, derivs);
+            ODE::rk4(activeAngles, Xn, &dXdt[0], h, Xdot, derivs, stages);
+            break;
+        case BogackiShampine:
+            /* repeat the step with a smaller one until the error estimate is
+             * within tolerance (a NaN always shrinks the step): */
+            for (int retry = 0; ; ++retry) {
+                const double stepErr = ODE::bs23(activeAngles, Xn, &dXdt[0], hAdaptive, Xdot, derivs,
+                                                 stages, ODE_TOL, ws.StepError.data());
+                const double hNext = ODE::nextStep(hAdaptive, stepErr, 3);
+                if ((stepErr <= 1.) || (retry == ODE_MAX_REJECT)) {
+                    hAccepted = hAdaptive; // logged after the iteration, it allocates
+                    acceptedErr = stepErr;
+                    hAdaptive = std::min(hNext, ODE_MAX_STEP);
+                    break;
+                }
+
+                ++rejected;
+                if (Logger::isEnabled(Logger::Verbose))
+                    Logger::log(Logger::Verbose, "step", "  -> step size h = " + std::to_string(hAdaptive)
+                                + " rejected (error estimate " + std::to_string(stepErr) + ")",
+                                {{"step", hAdaptive}, {"estimate", stepErr}, {"iteration", run + 1}});
+                hAdaptive = hNext;
+                backprojectAll(); // K1 was overwritten by the rejected step
+            }
             break;
         }
 
-        derivs.error(Xdot, Error);
-        double err = Error.mean();
+        derivs.projectAll(Xdot, ws.RadonXdot);
+        derivs.error(ws.RadonXdot, Error);
+        double err = Error.head(activeAngles).mean();
+        m_ErrorHistory.push_back(err);
 
-        std::string itrStr;
-        if (iterations == 0) { // discrepancy principle is used
-            itrStr = "Iteration no. " + std::to_string(run + 1)
-                     + " (of max " + std::to_string(max) + ")";
-        } else {
-            itrStr = "Iteration no. " + std::to_string(run + 1)
-                     + " / " + std::to_string(max);
+        allocs = AllocationCounter::allocations() - allocs;
+        threadAllocs = AllocationCounter::threadAllocations() - threadAllocs;
+        if ((run > firstRun) && (rejected == rejectedBefore)) { // a rejected step is no steady state
+            allocations = std::max(allocations, allocs);
+            threadAllocations = std::max(threadAllocations, threadAllocs);
+        }
+
+        if ((solver == BogackiShampine) && Logger::isEnabled(Logger::Verbose))
+            Logger::log(Logger::Verbose, "step", "  -> step size h = " + std::to_string(hAccepted)
+                        + " accepted (error estimate " + std::to_string(acceptedErr) + ")",
+                        {{"step", hAccepted}, {"estimate", acceptedErr}, {"iteration", run + 1}});
+
+        if (Logger::isEnabled(Logger::Info)) {
+            std::ostringstream os;
+            os << "Iteration no. " << (run + 1);
+            if (iterations == 0) // discrepancy principle is used
+                os << " (of max " << max << ")";
+            else
+                os << " / " << max;
+            os << " with error = " << std::fixed << err;
+            Logger::log(Logger::Info, "iteration", os.str(),
+                        {{"iteration", run + 1}, {"max", max}, {"error", err}});
         }
 
-        std::cout << itrStr << " with error = " << err << std::endl;
+        if (m_progress)
+            m_progress(m_level, run + 1, err);
 
         if (isnan(err)) {
-            std::cout << "Something bad happend! Stopping now!!!" << std::endl;
+            Logger::log(Logger::Error, "stop", "Something bad happend! Stopping now!!!",
+                        {{"reason", "nan"}, {"iteration", run + 1}});
             break; // we take the last result, because it is probably
                    // the better one (with an error != NAN)
         }
 
-        Xn = Xdot; // use regularized data for next iteration step (also as result)
+        Xn.swap(Xdot); // use regularized data for next iteration step (also as result)
+        ws.RadonXn.swap(ws.RadonXdot); // and its projections
+
+        if (nesterov) { // keep the last iterate for the momentum
+            ws.Xprev.swap(Xdot);
+            ws.RadonXprev.swap(ws.RadonXdot);
+            ++momentum;
+        }
 
-        /* discrepancy principle: */
-        if ((iterations == 0) && (err <= delta * TAU)) {
-            std::cout << "Stopping due to discrepancy level reached!" << std::endl;
+        /* discrepancy principle (not before all projections are known): */
+        const bool complete = (m_stream == nullptr) || (activeAngles == angles) || m_stream->isClosed();
+        if ((iterations == 0) && complete && (err <= delta * TAU)) {
+            Logger::log(Logger::Verbose, "stop", "Stopping due to discrepancy level reached!",
+                        {{"reason", "discrepancy"}, {"iteration", run + 1}});
             break; // quit while(), err is small enough
         }
 
+        /* checkpoint of Xn, also on cancel (not after the last iteration): */
+        if ((checkpoints != nullptr) && (run + 1 < max)
+                && (m_cancel || ((run + 1) % m_checkpointInterval == 0))) {
+            snapshot.config = config;
+            snapshot.solver = solver;
+            snapshot.projector = projector;
+            snapshot.precision = (sizeof(GridScalar) == sizeof(float)) ? SinglePrecision : DoublePrecision;
+            snapshot.delta = delta;
+            snapshot.iterations = iterations;
+            snapshot.step = step;
+            snapshot.iteration = run + 1;
+            snapshot.momentum = momentum;
+            snapshot.hAdaptive = hAdaptive;
+            snapshot.rejected = rejected;
+            snapshot.Xn = Xn.template cast<double>();
+            if (nesterov)
+                snapshot.Xprev = ws.Xprev.template cast<double>();
+            else
+                snapshot.Xprev.resize(0, 0);
+            snapshot.errors = m_ErrorHistory;
+            snapshot.dataSets = m_DataSet;
+            snapshot.random = randomState;
+            checkpoints->submit(snapshot);
+        }
+
+        /* cooperative cancel, Xn is the last accepted iteration: */
+        if (m_cancel) {
+            Logger::log(Logger::Verbose, "stop", "Stopping due to cancel request!",
+                        {{"reason", "cancel"}, {"iteration", run + 1}});
+            break;
+        }
+
         /* plot lastest iteration result: */
         if (sett != nullptr) {
+            std::string itrStr;
+            if (iterations == 0) { // discrepancy principle is used
+                itrStr = "Iteration no. " + std::to_string(run + 1)
+                         + " (of max " + std::to_string(max) + ")";
+            } else {
+                itrStr = "Iteration no. " + std::to_string(run + 1)
+                         + " / " + std::to_string(max);
+            }
+
             sett->setTitle(itrStr, 3);
             ContourPlotter plotter(sett, Plotter::Output_Display_Widget);
-            plotter.setData(Xdot);
+            plotter.setData(Xn.template cast<double>());
             plotter.plot(true); // keep open and do not block
         }
 
-        //STDOUT_MATRIX(Xdot);
+        //LOG_MATRIX(Xn);
     } while (++run < max);
     auto t2 = hrc::now(); // Stop timing
 
     /* calculate and pass back time used: */
-    if (time != nullptr)
-        *time = t2 - t1;
+    Duration dt(t2 - t1);
+    Logger::log(Logger::Info, "timing", "Regularization done in " + dt.toString(),
+                {{"stage", "regularize"}, {"seconds", dt.seconds()}});
 
-    std::cout << std::endl; // put another linebreak to stdout for easier reading
+    if (time != nullptr)
+        *time = dt;
 
     /* delete plottersettings copy: */
     delete sett;
 
-    /* Xdot = Xn + 2hR*{R(Xn)[Y - F(Xn)]} */
-    m_Result = Xdot;
-    return Error.mean();
+    /* an iteration must not allocate with any projector, the count of this
+     * thread is not disturbed by other engines or the checkpoint writer: */
+    assert(!parallelTeamsCached() || (threadAllocations == 0));
+
+    /* the counter is process-wide, engines running in parallel are included: */
+    m_allocations = allocations;
+    if ((run > firstRun) && AllocationCounter::isAvailable())
+        Logger::log(Logger::Verbose, "allocations", "Heap allocations per iteration: "
+                    + std::to_string(allocations),
+                    {{"allocations", double(allocations)}});
+
+    if (solver == BogackiShampine)
+        Logger::log(Logger::Verbose, "step", "Rejected steps: " + std::to_string(rejected)
+                    + ", next step size h = " + std::to_string(hAdaptive),
+                    {{"rejected", rejected}, {"step", hAdaptive}});
+
+    /* time breakdown of the hot paths (also includes engines running in parallel): */
+    if (Profiler::isEnabled())
+        logProfile(Profiler::totals() - profile, dt.seconds());
+
+    /* Xdot = Xn + 2hR*{R(Xn)[Y - F(Xn)]}, Xn holds the last accepted Xdot */
+    m_Result = Xn.template cast<double>();
+    return Error.head(derivs.activeCount()).mean();
+}
+
+/**
+ * @brief Sets the initial value of regularize() for grids of the same size
+ * as @a X0, other grids start with X0_C as before.
+ * The value is kept for all following runs until clearInitialValue().
+ */
+void AsymRegEngine::setInitialValue(const MatrixXd &X0)
+{
+    assert(X0.rows() == X0.cols());
+    m_InitialValue = X0;
+}
+
+/**
+ * @brief Interpolates the grid data @a X bilinearly on a grid of
+ * [@a gridSize x @a gridSize]. Both grids cover the physical coord. system.
+ */
+MatrixXd AsymRegEngine::prolongate(const MatrixXd &X, int gridSize)
+{
+    RowVectorXd XsiCoarse = RowVectorXd::LinSpaced(Sequential, X.rows(), 0., 10.);
+    RowVectorXd Xsi = RowVectorXd::LinSpaced(Sequential, gridSize, 0., 10.);
+    BilinearInterpol interp(XsiCoarse, XsiCoarse, X);
+
+    /* all grid points at once, column-major like the result: */
+    Matrix<double, 2, Dynamic> Pts(2, gridSize * gridSize);
+    for (int j = 0; j < gridSize; ++j) {
+        Pts.row(0).segment(j * gridSize, gridSize) = Xsi;
+        Pts.row(1).segment(j * gridSize, gridSize).setConstant(Xsi(j));
+    }
+
+    RowVectorXd Values(Pts.cols());
+    interp.interpol(Pts, Values);
+
+    return Map<MatrixXd>(Values.data(), gridSize, gridSize);
+}
+
+/**
+ * @brief Grid sizes of the levels of regularizeMultilevel(), coarse to fine:
+ * ML_GRID, 2*ML_GRID, ... up to half of @a gridSize followed by @a gridSize.
+ */
+std::vector<int> AsymRegEngine::multilevelGrids(int gridSize)
+{
+    std::vector<int> levels;
+    for (int size = ML_GRID; 2 * size <= gridSize; size *= 2)
+        levels.push_back(size);
+    levels.push_back(gridSize);
+
+    return levels;
+}
+
+/**
+ * @brief Runs regularize() on a sequence of grids, coarse to fine.
+ * The levels are given by multilevelGrids(), the last one is the target
+ * grid itself. Each result is prolongated as the
+ * initial value of the next level. The coarse levels stop by the discrepancy
+ * principle, the target grid uses @a iterations as regularize() does. The
+ * data sets do not depend on the grid, so a discrepancy reached on a coarse
+ * level leaves only few iterations for the finer ones, which are much more
+ * expensive.
+ * @return Error of the target grid.
+ */
+double AsymRegEngine::regularizeMultilevel(const ReconstructionConfig &config, double delta,
+                                           ODE_Solver solver, int iterations, double step,
+                                           const PlotterSettings *pl, Duration *time,
+                                           Projector projector)
+{
+    auto t1 = hrc::now();
+
+    const std::vector<int> levels = multilevelGrids(config.gridSize);
+
+    const MatrixXd initialValue = m_InitialValue; // restored at the end
+    CheckpointWriter *checkpoints = m_CheckpointWriter; // also restored at the end
+    double err = 0.;
+    m_LevelIterations.clear();
+    for (std::size_t l = 0; l < levels.size(); ++l) {
+        ReconstructionConfig levelConfig = config;
+        levelConfig.gridSize = levels[l];
+
+        const bool finest = (l + 1 == levels.size());
+        Logger::log(Logger::Info, "level", "Level " + std::to_string(l + 1) + " / "
+                    + std::to_string(levels.size()) + " on grid ["
+                    + std::to_string(levels[l]) + "x" + std::to_string(levels[l]) + "]",
+                    {{"level", int(l + 1)}, {"grid", levels[l]}});
+
+        m_CheckpointWriter = finest ? checkpoints : nullptr; // the target grid only
+        m_level = int(l + 1);
+        err = regularize(levelConfig, delta, solver, finest ? iterations : 0,
+                         step, finest ? pl : nullptr, nullptr, projector);
+        m_level = 0;
+        m_LevelIterations.push_back(int(m_ErrorHistory.size()));
+
+        if (finest || m_cancel || isnan(err))
+            break;
+
+        setInitialValue(prolongate(m_Result, levels[l + 1]));
+    }
+
+    m_InitialValue = initialValue;
+    m_CheckpointWriter = checkpoints;
+
+    Duration dt(hrc::now() - t1);
+    Logger::log(Logger::Info, "timing", "Multilevel regularization done in " + dt.toString(),
+                {{"stage", "multilevel"}, {"seconds", dt.seconds()}, {"levels", int(levels.size())}});
+
+    if (time != nullptr)
+        *time = dt;
+
+    return err;
+}
+
+/**
+ * @brief Lets regularize() write a checkpoint to @a fileName every
+ * @a interval iterations and when it is cancelled, see resume().
+ * The checkpoints are written by a thread of their own, each one replaces the
+ * file. Streamed data sets and the coarse levels of regularizeMultilevel() are
+ * not checkpointed. Pass an empty @a fileName to stop writing checkpoints.
+ */
+void AsymRegEngine::setCheckpointFile(const std::string &fileName, int interval)
+{
+    assert(interval > 0);
+
+    if ((m_CheckpointWriter == nullptr) || (m_CheckpointWriter->fileName() != fileName)) {
+        delete m_CheckpointWriter; // writes the last checkpoint first
+        m_CheckpointWriter = fileName.empty() ? nullptr : new CheckpointWriter(fileName);
+    }
+
+    m_checkpointInterval = interval;
+}
+
+/**
+ * @brief Continues the run of checkpoint @a cp exactly where it was stopped.
+ * The data sets, the random generator and the precision are the ones of that
+ * run, the iterations go on with its iterate and solver state. So the result
+ * and the errorHistory() are the same as if the run had not been interrupted.
+ * A data set stream is not used by resume().
+ */
+double AsymRegEngine::resume(const Checkpoint &cp, const PlotterSettings *pl, Duration *time)
+{
+    assert(cp.config.isValid() && (cp.Xn.rows() == cp.config.gridSize));
+    assert(cp.iteration < ((cp.iterations > 0) ? cp.iterations : T));
+
+    DataSetStream *stream = m_stream; // restored at the end
+    const Precision precision = m_precision;
+
+    m_stream = nullptr;
+    m_precision = cp.precision;
+    m_DataSet = cp.dataSets;
+    std::istringstream is(cp.random);
+    std::operator>>(is, m_Random); // not the one of eigen_io.h
+
+    Logger::log(Logger::Info, "resume", "Resuming after iteration no. " + std::to_string(cp.iteration),
+                {{"iteration", cp.iteration}});
+
+    m_Resume = &cp;
+    const double err = regularize(cp.config, cp.delta, cp.solver, cp.iterations, cp.step,
+                                  pl, time, cp.projector);
+    m_Resume = nullptr;
+
+    m_stream = stream;
+    m_precision = precision;
+
+    return err;
 }
 
-Matrix<double, Dynamic, Dynamic> AsymReg::sourceFunctionPlotData(Duration *time)
+Matrix<double, Dynamic, Dynamic> AsymRegEngine::sourceFunctionPlotData(int gridSize, Duration *time) const
 {
     assert(m_sourceFunc != nullptr);
 
     auto t1 = hrc::now();
-    VectorXd X = VectorXd::LinSpaced(Sequential, ASYMREG_GRID_SIZE, 0., 10.);
-    MatrixXd Z(ASYMREG_GRID_SIZE, ASYMREG_GRID_SIZE);
+    VectorXd X = VectorXd::LinSpaced(Sequential, gridSize, 0., 10.);
+    MatrixXd Z(gridSize, gridSize);
 
     for (int i = 0; i < X.rows(); ++i) {
         for (int j = 0; j < X.rows(); ++j)
@@ -534,7 +1616,7 @@ Matrix<double, Dynamic, Dynamic> AsymReg::sourceFunctionPlotData(Duration *time)
     return Z;
 }
 
-void AsymReg::setSourceFunction(BilinearInterpol *func)
+void AsymRegEngine::setSourceFunction(BilinearInterpol *func)
 {
     assert(func != nullptr);
 
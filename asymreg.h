@@ -1,54 +1,226 @@
 #ifndef ASYMREG_H_
 #define ASYMREG_H_
 
-#define ASYMREG_DATSRC_SIZE  30
-
-#define ASYMREG_GRID_SIZE  300
-
-#define AR_NUM_REC_ANGL  100
-
-#define AR_TRGT_SMPL_RATE  0.05
-
 #define AR_DELTA 0.02
 
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
 #include "eigen.h"
+#include "reconstructionconfig.h"
 
 class BilinearInterpol;
+class CheckpointWriter;
 class Duration;
 class PlotterSettings;
-
-class AsymReg {
+class DataSetStream;
+template <typename _Scalar> class BasicRadonMatrix;
+typedef BasicRadonMatrix<double> RadonMatrix;
+typedef BasicRadonMatrix<float> RadonMatrixf;
+template <typename _Scalar> struct RegularizationWorkspace;
+struct Checkpoint;
+
+/**
+ * @brief Asymptotical Regularization engine.
+ * An engine owns everything a reconstruction needs: the source function, the
+ * generated data sets, the solver workspace, the random generator for the data
+ * pertubation and the result. There is no shared mutable state between
+ * engines, so several engines can run at once on different threads.
+ * A single engine must not be used by more than one thread at a time, the only
+ * exception is requestCancel() which may be called from any thread.
+ */
+class AsymRegEngine {
 public:
-    inline static BilinearInterpol *sourceFunction()
+    enum ODE_Solver {
+        Euler,
+        Midpoint,  // RK2
+        RungeKutta, // RK4
+        BogackiShampine, // RK3(2), adaptive step size
+        Nesterov   // accelerated Landweber, Euler steps with momentum
+    };
+
+    enum Projector {
+        SampledProjector,      // RadonOperator & Backprojection, sample by sample
+        SystemMatrixProjector, // RadonMatrix, assembled once per run
+        FourierProjector       // FourierSlice, all angles by one FFT (Euler & Nesterov)
+    };
+
+    enum Precision {
+        DoublePrecision,
+        SinglePrecision // float grid data and system matrix, double errors
+    };
+
+    enum InitialGuess {
+        ConstantGuess,              // X0 = X0_C everywhere
+        FilteredBackprojectionGuess // FBP of sqrt(Y_delta), at least X0_C
+    };
+
+    AsymRegEngine();
+    ~AsymRegEngine();
+
+    /**
+     * @brief Called by regularize() after each iteration with the number of
+     * the iteration (counted from 1) and its mean error. @a level is the
+     * level of regularizeMultilevel() (counted from 1) the iteration belongs
+     * to, or 0 for a plain regularize(). The callback is executed in the
+     * thread running regularize().
+     */
+    typedef std::function<void (int level, int iteration, double error)> ProgressCallback;
+
+    AsymRegEngine(const AsymRegEngine &) = delete;
+    AsymRegEngine &operator=(const AsymRegEngine &) = delete;
+
+    inline BilinearInterpol *sourceFunction() const
     { return m_sourceFunc; }
 
-    static MatrixXd sourceFunctionPlotData(Duration *time = nullptr);
+    MatrixXd sourceFunctionPlotData(int gridSize = ASYMREG_GRID_SIZE,
+                                    Duration *time = nullptr) const;
 
-    static void createSourceFunction(const MatrixXd &srcDat);
+    void createSourceFunction(const Ref<const MatrixXd> &srcDat);
+    void createSourceFunction(const Map<const MatrixXd> &srcDat, const std::shared_ptr<const void> &owner);
 
-    static void generateDataSet(int recordingAngles,
-                                double delta = AR_DELTA,
-                                Duration *time = nullptr);
+    void setRandomSeed(unsigned int seed);
 
-    enum ODE_Solver {
-        Euler,
-        Midpoint,  // RK2
-        RungeKutta // RK4
-    };
+    void generateDataSet(const ReconstructionConfig &config,
+                         double delta = AR_DELTA,
+                         Duration *time = nullptr);
+
+    inline const std::vector<RowVectorXd> &dataSet() const
+    { return m_DataSet; }
+
+    void setDataSet(const std::vector<RowVectorXd> &dataSet);
+
+    static std::shared_ptr<const RadonMatrix> createSystemMatrix(const ReconstructionConfig &config);
+
+    void setSystemMatrix(const std::shared_ptr<const RadonMatrix> &A);
+    void setSystemMatrix(const std::shared_ptr<const RadonMatrixf> &A);
+
+    /**
+     * @brief Sets the precision of the grid data used by regularize().
+     * Single precision needs the SystemMatrixProjector, with the
+     * SampledProjector regularize() falls back to double precision.
+     */
+    inline void setPrecision(Precision precision)
+    { m_precision = precision; }
+
+    inline Precision precision() const
+    { return m_precision; }
+
+    void setDataSetStream(DataSetStream *stream);
 
-    static double regularize(int recordingAngles, double delta,
-                             ODE_Solver solver, int iterations, double step,
-                             const PlotterSettings *pl, Duration *time = nullptr);
+    /**
+     * @brief Sets how regularize() computes the initial value X0.
+     * An initial value set by setInitialValue() takes precedence, streamed
+     * data sets always start with the constant.
+     */
+    inline void setInitialGuess(InitialGuess guess)
+    { m_initialGuess = guess; }
 
-    static const MatrixXd &result()
+    inline InitialGuess initialGuess() const
+    { return m_initialGuess; }
+
+    void setInitialValue(const MatrixXd &X0);
+
+    inline void clearInitialValue()
+    { m_InitialValue.resize(0, 0); }
+
+    double regularize(const ReconstructionConfig &config, double delta,
+                      ODE_Solver solver, int iterations, double step,
+                      const PlotterSettings *pl, Duration *time = nullptr,
+                      Projector projector = SampledProjector);
+
+    double regularizeMultilevel(const ReconstructionConfig &config, double delta,
+                                ODE_Solver solver, int iterations, double step,
+                                const PlotterSettings *pl, Duration *time = nullptr,
+                                Projector projector = SampledProjector);
+
+    static std::vector<int> multilevelGrids(int gridSize);
+    static MatrixXd prolongate(const MatrixXd &X, int gridSize);
+
+    void setCheckpointFile(const std::string &fileName, int interval = 1);
+
+    double resume(const Checkpoint &cp, const PlotterSettings *pl, Duration *time = nullptr);
+
+    inline const MatrixXd &result() const
     { return m_Result; }
 
-private:
-    static void setSourceFunction(BilinearInterpol *func);
+    /**
+     * @brief Mean error of every iteration of the last regularize() run,
+     * including the ones before a resume().
+     */
+    inline const std::vector<double> &errorHistory() const
+    { return m_ErrorHistory; }
+
+    /**
+     * @brief Iterations done on each level of the last regularizeMultilevel()
+     * run, coarse to fine.
+     */
+    inline const std::vector<int> &levelIterations() const
+    { return m_LevelIterations; }
+
+    /**
+     * @brief Most heap allocations of one iteration of the last regularize()
+     * run, the first iteration is not counted. The count is process-wide and
+     * stays at 0 if AllocationCounter::isAvailable() is false.
+     */
+    inline unsigned long long allocationsPerIteration() const
+    { return m_allocations; }
+
+    void setProgressCallback(const ProgressCallback &callback);
+
+    /**
+     * @brief Asks a running regularize() to stop after the current iteration.
+     * The last accepted iteration is kept as result. The request stays active
+     * until resetCancel() is called.
+     */
+    inline void requestCancel()
+    { m_cancel = true; }
+
+    inline void resetCancel()
+    { m_cancel = false; }
+
+    inline bool isCancelRequested() const
+    { return m_cancel; }
 
-    static BilinearInterpol *m_sourceFunc;
-    static Matrix<double, Dynamic, Dynamic> m_Result;
-    static RowVectorXd m_DataSet[AR_NUM_REC_ANGL];
+private:
+    void setSourceFunction(BilinearInterpol *func);
+
+    template <typename GridScalar>
+    double regularizeWith(const ReconstructionConfig &config, double delta,
+                          ODE_Solver solver, int iterations, double step,
+                          const PlotterSettings *pl, Duration *time, Projector projector);
+
+    template <typename GridScalar>
+    RegularizationWorkspace<GridScalar> &workspace();
+
+    template <typename GridScalar>
+    std::shared_ptr<const BasicRadonMatrix<GridScalar> > systemMatrix(const ReconstructionConfig &config);
+
+    BilinearInterpol *m_sourceFunc;
+    Matrix<double, Dynamic, Dynamic> m_Result;
+    std::vector<double> m_ErrorHistory;
+    std::vector<int> m_LevelIterations;
+    MatrixXd m_InitialValue;
+    std::vector<RowVectorXd> m_DataSet;
+    std::shared_ptr<const RadonMatrix> m_SystemMatrix;
+    std::shared_ptr<const RadonMatrixf> m_SystemMatrixF;
+    Precision m_precision;
+    InitialGuess m_initialGuess;
+    DataSetStream *m_stream;
+    RegularizationWorkspace<double> *m_Workspace;
+    RegularizationWorkspace<float> *m_WorkspaceF;
+    CheckpointWriter *m_CheckpointWriter;
+    int m_checkpointInterval;
+    const Checkpoint *m_Resume;
+    std::mt19937 m_Random;
+    unsigned long long m_allocations;
+    int m_level;
+    ProgressCallback m_progress;
+    std::atomic<bool> m_cancel;
 };
 
 #endif // ASYMREG_H_
@@ -0,0 +1,63 @@
+#include "asymregworker.h"
+
+AsymRegWorker::AsymRegWorker(AsymRegEngine *engine)
+    : m_engine(engine)
+{
+    Q_ASSERT(engine != nullptr);
+
+    m_engine->setProgressCallback([this](int level, int iteration, double error) {
+        emit progress(level, iteration, error);
+    });
+}
+
+AsymRegWorker::~AsymRegWorker()
+{
+    m_engine->setProgressCallback(nullptr);
+}
+
+/**
+ * @brief Sets the parameters for the next call of run().
+ * Must not be called while a job is running.
+ */
+void AsymRegWorker::setJob(const Job &job)
+{
+    m_job = job;
+}
+
+void AsymRegWorker::run()
+{
+    double error = 0.;
+
+    m_engine->setCheckpointFile(m_job.checkpointFile);
+
+    if (m_job.resume) { // with the data sets of the checkpoint
+        if (!m_engine->isCancelRequested())
+            error = m_engine->resume(*m_job.resume, nullptr, &m_duration);
+
+        emit finished(error);
+        return;
+    }
+
+    if (!m_engine->isCancelRequested())
+        m_engine->generateDataSet(m_job.config, m_job.delta);
+
+    if (!m_engine->isCancelRequested() && m_job.multilevel) {
+        error = m_engine->regularizeMultilevel(m_job.config,
+                                               m_job.delta,
+                                               m_job.solver,
+                                               m_job.iterations,
+                                               m_job.step,
+                                               nullptr,//m_pressureFunctionPlotSettings,
+                                               &m_duration);
+    } else if (!m_engine->isCancelRequested()) {
+        error = m_engine->regularize(m_job.config,
+                                     m_job.delta,
+                                     m_job.solver,
+                                     m_job.iterations,
+                                     m_job.step,
+                                     nullptr,//m_pressureFunctionPlotSettings,
+                                     &m_duration);
+    }
+
+    emit finished(error);
+}
@@ -0,0 +1,58 @@
+#ifndef ASYMREGWORKER_H_
+#define ASYMREGWORKER_H_
+
+#include <QtCore/QObject>
+
+#include <memory>
+#include <string>
+
+#include "asymreg.h"
+#include "duration.h"
+
+/**
+ * @brief Runs generateDataSet() and regularize() of an AsymRegEngine, or
+ * resume() of a checkpoint.
+ * The worker is meant to be moved to its own QThread, run() is then invoked
+ * by a queued call and the GUI thread keeps responsive. Signals are emitted in
+ * the worker's thread, so receivers in the GUI thread get them queued.
+ * The engine must not be touched by other threads while a job is running,
+ * except for AsymRegEngine::requestCancel().
+ */
+class AsymRegWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Job {
+        ReconstructionConfig config;
+        double delta;
+        AsymRegEngine::ODE_Solver solver;
+        int iterations;
+        double step;
+        bool multilevel; // AsymRegEngine::regularizeMultilevel()
+        std::string checkpointFile; // AsymRegEngine::setCheckpointFile(), empty: none
+        std::shared_ptr<const Checkpoint> resume; // continues this run instead (AsymRegEngine::resume())
+    };
+
+    AsymRegWorker(AsymRegEngine *engine);
+    virtual ~AsymRegWorker();
+
+    void setJob(const Job &job);
+
+    inline const Duration &duration() const
+    { return m_duration; }
+
+public slots:
+    void run();
+
+signals:
+    void progress(int level, int iteration, double error);
+    void finished(double error);
+
+private:
+    AsymRegEngine *m_engine;
+    Job m_job;
+    Duration m_duration;
+};
+
+#endif // ASYMREGWORKER_H_
@@ -1,6 +1,8 @@
 #ifndef BACKPROJECTION_H_
 #define BACKPROJECTION_H_
 
+#include <algorithm>
+
 /**
  * Adjoint Radon Operator
  */
@@ -25,6 +27,34 @@ public:
         return ret;
     }
 
+    /**
+     * @brief Evaluates the Backprojection on every point of the grid @a U x @a V.
+     * For a fixed angle s = sigma_0*U(k) + sigma_1*V(l) is affine in (k,l), so
+     * every column of @a Out is the ramp sigma_0*U shifted by a constant. The
+     * column is passed to the batched version of Func in blocks on the stack,
+     * which needs to provide operator()(const double *s, int count, double *ret).
+     * @param U Discrete samples of first axis (target coord. system).
+     * @param V Discrete samples of second axis (target coord. system).
+     * @param Out Matrix which receives the data, resized to [U x V].
+     */
+    void grid(const Eigen::VectorXd &U, const Eigen::VectorXd &V, Eigen::MatrixXd &Out)
+    {
+        Out.resize(U.size(), V.size());
+
+        const int blockSize = 64;
+        double S[blockSize];
+
+        for (int l = 0; l < V.size(); ++l) {
+            const double shift = m_Sigma(1) * V(l);
+            for (int b = 0; b < U.size(); b += blockSize) {
+                const int count = std::min<int>(blockSize, U.size() - b);
+                for (int k = 0; k < count; ++k)
+                    S[k] = m_Sigma(0) * U(b + k) + shift;
+                m_Func(S, count, Out.col(l).data() + b);
+            }
+        }
+    }
+
 private:
     Func &m_Func;
     Eigen::Vector2d m_Sigma;
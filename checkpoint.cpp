@@ -0,0 +1,338 @@
+#include "checkpoint.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include "logger.h"
+
+/* Checkpoint file (*.arcp):
+ * =========================
+ * A 128 byte header with the scalar state, followed by binary matrix blocks
+ * (header and payload of a *.armx file, each with its own checksum) of Xn,
+ * Xprev, the error history and the data sets (one row per recording angle)
+ * and finally the state of the random generator as text. Xn and Xprev of a
+ * single precision run are stored as float, which loses nothing. Everything
+ * is in host byte order.
+ * A checkpoint is written to "<file>.tmp" first and renamed afterwards, so a
+ * run killed while writing leaves the previous checkpoint intact.
+ */
+struct CheckpointHeader
+{
+    enum {
+        Version = 1
+    };
+
+    char magic[4];                // "ARCP"
+    std::uint16_t version;        // Version
+    std::uint8_t solver;
+    std::uint8_t projector;
+    std::uint8_t precision;
+    std::uint8_t reserved0[3];
+    std::int32_t gridSize;
+    std::int32_t recordingAngles;
+    std::int32_t sourceSize;
+    std::int32_t iterations;
+    std::int32_t iteration;
+    std::int32_t momentum;
+    std::int32_t rejected;
+    std::uint32_t reserved1;
+    double sampleRate;
+    double delta;
+    double step;
+    double hAdaptive;
+    std::uint64_t randomSize;
+    std::uint64_t randomChecksum; // binary_matrix_checksum() of the random state
+    std::uint8_t reserved[32];
+};
+
+static_assert(sizeof(CheckpointHeader) == 128, "header has to keep the blocks aligned");
+
+static bool fail(std::string *error, const std::string &message)
+{
+    if (error != nullptr)
+        *error = message;
+    return false;
+}
+
+/* reads the next matrix block of the file contents @a data at @a pos: */
+static bool readBlock(const std::string &data, std::size_t *pos, MatrixXd *m, const char *name,
+                      std::string *error)
+{
+    const std::string blockName = std::string("block ") + name;
+
+    BinaryMatrixHeader h;
+    if (data.size() - *pos < sizeof(h))
+        return fail(error, blockName + " is missing");
+    std::memcpy(&h, data.data() + *pos, sizeof(h));
+    *pos += sizeof(h);
+
+    if (!h.hasMagic() || (h.version != BinaryMatrixHeader::Version) || (h.scalarSize() == 0)
+            || (h.layout > BinaryMatrixHeader::RowMajorLayout))
+        return fail(error, blockName + " has an invalid header");
+
+    const std::size_t remaining = data.size() - *pos;
+    if ((h.cols != 0) && (h.rows > remaining / h.cols / h.scalarSize()))
+        return fail(error, blockName + " is truncated");
+
+    const std::size_t bytes = h.rows * h.cols * h.scalarSize();
+    const char *payload = data.data() + *pos;
+    if (binary_matrix_checksum(payload, bytes) != h.checksum)
+        return fail(error, blockName + " has a wrong checksum");
+    *pos += bytes;
+
+    /* the payload of the file contents is not aligned, so copy it first: */
+    const bool rowMajor = (h.layout == BinaryMatrixHeader::RowMajorLayout);
+    if (h.scalarType == BinaryMatrixHeader::Float32) {
+        std::vector<float> values(h.rows * h.cols);
+        std::memcpy(values.data(), payload, bytes);
+        if (rowMajor)
+            *m = Map<const Matrix<float, Dynamic, Dynamic, RowMajor> >(values.data(), h.rows, h.cols).cast<double>();
+        else
+            *m = Map<const MatrixXf>(values.data(), h.rows, h.cols).cast<double>();
+    } else if (rowMajor) {
+        std::vector<double> values(h.rows * h.cols);
+        std::memcpy(values.data(), payload, bytes);
+        *m = Map<const Matrix<double, Dynamic, Dynamic, RowMajor> >(values.data(), h.rows, h.cols);
+    } else {
+        m->resize(h.rows, h.cols);
+        std::memcpy(m->data(), payload, bytes);
+    }
+
+    return true;
+}
+
+Checkpoint::Checkpoint()
+    : solver(AsymRegEngine::Euler),
+      projector(AsymRegEngine::SampledProjector),
+      precision(AsymRegEngine::DoublePrecision),
+      delta(0.),
+      iterations(0),
+      step(0.),
+      iteration(0),
+      momentum(0),
+      hAdaptive(0.),
+      rejected(0)
+{
+}
+
+/**
+ * @brief Writes checkpoint @a cp to @a fileName, replacing an older one.
+ * @return @c false on failure, @a error is set to the reason then.
+ */
+bool writeCheckpoint(const std::string &fileName, const Checkpoint &cp, std::string *error)
+{
+    const int angles = cp.dataSets.size();
+    const int numSamples = (angles > 0) ? cp.dataSets[0].size() : 0;
+
+    CheckpointHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, "ARCP", 4);
+    header.version = CheckpointHeader::Version;
+    header.solver = cp.solver;
+    header.projector = cp.projector;
+    header.precision = cp.precision;
+    header.gridSize = cp.config.gridSize;
+    header.recordingAngles = cp.config.recordingAngles;
+    header.sourceSize = cp.config.sourceSize;
+    header.iterations = cp.iterations;
+    header.iteration = cp.iteration;
+    header.momentum = cp.momentum;
+    header.rejected = cp.rejected;
+    header.sampleRate = cp.config.sampleRate;
+    header.delta = cp.delta;
+    header.step = cp.step;
+    header.hAdaptive = cp.hAdaptive;
+    header.randomSize = cp.random.size();
+    header.randomChecksum = binary_matrix_checksum(cp.random.data(), cp.random.size());
+
+    MatrixXd DataSets(angles, numSamples);
+    for (int n = 0; n < angles; ++n)
+        DataSets.row(n) = cp.dataSets[n];
+
+    const std::string tmpName = fileName + ".tmp";
+    std::ofstream fs(tmpName, std::ios::out | std::ios::binary | std::ios::trunc);
+    fs.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    if (cp.precision == AsymRegEngine::SinglePrecision) {
+        export_matrix_binary(fs, cp.Xn.cast<float>());
+        export_matrix_binary(fs, cp.Xprev.cast<float>());
+    } else {
+        export_matrix_binary(fs, cp.Xn);
+        export_matrix_binary(fs, cp.Xprev);
+    }
+    export_matrix_binary(fs, Map<const RowVectorXd>(cp.errors.data(), cp.errors.size()));
+    export_matrix_binary(fs, DataSets);
+    fs.write(cp.random.data(), cp.random.size());
+    fs.close();
+
+    if (fs.fail()) {
+        std::remove(tmpName.c_str());
+        return fail(error, "Cannot write checkpoint file " + tmpName);
+    }
+
+    if (std::rename(tmpName.c_str(), fileName.c_str()) != 0) {
+        std::remove(tmpName.c_str());
+        return fail(error, "Cannot replace checkpoint file " + fileName);
+    }
+
+    return true;
+}
+
+/**
+ * @brief Reads a checkpoint written by writeCheckpoint() into @a cp.
+ * The checksums of all blocks are verified.
+ * @return @c false if the file cannot be read or is not a valid checkpoint,
+ * @a error is set to the reason then.
+ */
+bool readCheckpoint(const std::string &fileName, Checkpoint *cp, std::string *error)
+{
+    std::ifstream fs(fileName, std::ios::in | std::ios::binary);
+    if (!fs)
+        return fail(error, "Cannot open checkpoint file " + fileName);
+
+    const std::string data((std::istreambuf_iterator<char>(fs)), std::istreambuf_iterator<char>());
+    if (fs.bad())
+        return fail(error, "Cannot read checkpoint file " + fileName);
+
+    const std::string invalid = "Invalid checkpoint file " + fileName + ": ";
+
+    CheckpointHeader header;
+    if (data.size() < sizeof(header))
+        return fail(error, invalid + "header is truncated");
+    std::memcpy(&header, data.data(), sizeof(header));
+
+    if (std::memcmp(header.magic, "ARCP", 4) != 0)
+        return fail(error, invalid + "no checkpoint");
+    if (header.version != CheckpointHeader::Version)
+        return fail(error, invalid + "unknown version " + std::to_string(header.version));
+    if ((header.solver > AsymRegEngine::Nesterov) || (header.projector > AsymRegEngine::FourierProjector)
+            || (header.precision > AsymRegEngine::SinglePrecision))
+        return fail(error, invalid + "unknown solver, projector or precision");
+
+    cp->config.gridSize = header.gridSize;
+    cp->config.recordingAngles = header.recordingAngles;
+    cp->config.sampleRate = header.sampleRate;
+    cp->config.sourceSize = header.sourceSize;
+    if (!cp->config.isValid())
+        return fail(error, invalid + "invalid configuration");
+
+    cp->solver = AsymRegEngine::ODE_Solver(header.solver);
+    cp->projector = AsymRegEngine::Projector(header.projector);
+    cp->precision = AsymRegEngine::Precision(header.precision);
+    cp->delta = header.delta;
+    cp->iterations = header.iterations;
+    cp->step = header.step;
+    cp->iteration = header.iteration;
+    cp->momentum = header.momentum;
+    cp->hAdaptive = header.hAdaptive;
+    cp->rejected = header.rejected;
+
+    std::size_t pos = sizeof(header);
+    MatrixXd Errors, DataSets;
+    if (!readBlock(data, &pos, &cp->Xn, "Xn", error)
+            || !readBlock(data, &pos, &cp->Xprev, "Xprev", error)
+            || !readBlock(data, &pos, &Errors, "errors", error)
+            || !readBlock(data, &pos, &DataSets, "data sets", error)) {
+        if (error != nullptr)
+            *error = invalid + *error;
+        return false;
+    }
+
+    const int gridSize = cp->config.gridSize;
+    if ((cp->Xn.rows() != gridSize) || (cp->Xn.cols() != gridSize)
+            || ((cp->Xprev.size() != 0) && ((cp->Xprev.rows() != gridSize) || (cp->Xprev.cols() != gridSize))))
+        return fail(error, invalid + "grid size does not fit");
+    if ((DataSets.rows() != cp->config.recordingAngles) || (DataSets.cols() != cp->config.numSamples()))
+        return fail(error, invalid + "data sets do not fit");
+    if ((cp->iteration < 1) || (Errors.size() != cp->iteration))
+        return fail(error, invalid + "error history does not fit");
+
+    cp->errors.assign(Errors.data(), Errors.data() + Errors.size());
+    cp->dataSets.resize(DataSets.rows());
+    for (int n = 0; n < DataSets.rows(); ++n)
+        cp->dataSets[n] = DataSets.row(n);
+
+    if ((data.size() - pos != header.randomSize)
+            || (binary_matrix_checksum(data.data() + pos, header.randomSize) != header.randomChecksum))
+        return fail(error, invalid + "random state is damaged");
+    cp->random.assign(data.data() + pos, header.randomSize);
+
+    return true;
+}
+
+CheckpointWriter::CheckpointWriter(const std::string &fileName)
+    : m_fileName(fileName),
+      m_hasPending(false),
+      m_busy(false),
+      m_stop(false),
+      m_thread(&CheckpointWriter::run, this)
+{
+}
+
+/**
+ * @brief Writes the last submitted checkpoint and stops the thread.
+ */
+CheckpointWriter::~CheckpointWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+
+    m_cond.notify_all();
+    m_thread.join();
+}
+
+/**
+ * @brief Queues @a cp to be written.
+ * The checkpoint is swapped in, so @a cp holds the buffers of an older one
+ * afterwards: filling it again next time does not need to allocate memory.
+ */
+void CheckpointWriter::submit(Checkpoint &cp)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::swap(m_pending, cp);
+        m_hasPending = true;
+    }
+
+    m_cond.notify_all();
+}
+
+/**
+ * @brief Waits until all submitted checkpoints are written.
+ */
+void CheckpointWriter::flush()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cond.wait(lock, [this] { return !m_hasPending && !m_busy; });
+}
+
+void CheckpointWriter::run()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_cond.wait(lock, [this] { return m_hasPending || m_stop; });
+        if (!m_hasPending)
+            return; // stopped and nothing left to write
+
+        std::swap(m_writing, m_pending);
+        m_hasPending = false;
+        m_busy = true;
+        lock.unlock();
+
+        std::string error;
+        if (writeCheckpoint(m_fileName, m_writing, &error))
+            Logger::log(Logger::Verbose, "checkpoint", "Checkpoint of iteration no. "
+                        + std::to_string(m_writing.iteration) + " written to " + m_fileName,
+                        {{"iteration", m_writing.iteration}, {"file", m_fileName}});
+        else
+            Logger::log(Logger::Error, "checkpoint", error, {{"file", m_fileName}});
+
+        lock.lock();
+        m_busy = false;
+        m_cond.notify_all();
+    }
+}
@@ -0,0 +1,86 @@
+#ifndef CHECKPOINT_H_
+#define CHECKPOINT_H_
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "asymreg.h"
+#include "eigen.h"
+#include "reconstructionconfig.h"
+
+/**
+ * @brief State of a regularize() run after an accepted iteration.
+ * Holds everything AsymRegEngine::resume() needs to continue the run exactly
+ * where it stopped: the arguments of regularize(), the iterate Xn and the
+ * state of the solver, the error history, the data sets and the state of the
+ * random generator of the engine. The forward projections of Xn are not
+ * stored, they are computed again.
+ */
+struct Checkpoint
+{
+    Checkpoint();
+
+    ReconstructionConfig config;
+    AsymRegEngine::ODE_Solver solver;
+    AsymRegEngine::Projector projector;
+    AsymRegEngine::Precision precision;
+    double delta;
+    int iterations;     /**< as passed to regularize(), 0: discrepancy principle */
+    double step;        /**< as passed to regularize(), 0: default step size */
+
+    int iteration;      /**< number of accepted iterations */
+    int momentum;       /**< Nesterov: number of steps since the last restart */
+    double hAdaptive;   /**< Bogacki-Shampine: step size of the next iteration */
+    int rejected;       /**< Bogacki-Shampine: rejected steps so far */
+
+    MatrixXd Xn;                     /**< last accepted iteration */
+    MatrixXd Xprev;                  /**< Nesterov: iteration before Xn */
+    std::vector<double> errors;      /**< mean error of every iteration */
+    std::vector<RowVectorXd> dataSets;
+    std::string random;              /**< std::mt19937 state, as written by operator<< */
+};
+
+bool writeCheckpoint(const std::string &fileName, const Checkpoint &cp, std::string *error = nullptr);
+bool readCheckpoint(const std::string &fileName, Checkpoint *cp, std::string *error = nullptr);
+
+/**
+ * @brief Writes checkpoints on a thread of its own, so the regulariser is not
+ * stalled by the disk.
+ * submit() hands over a checkpoint and returns at once. If the thread is still
+ * busy with the previous one, a checkpoint waiting to be written is replaced
+ * by the newer one, only the latest state matters for a resume.
+ */
+class CheckpointWriter
+{
+public:
+    explicit CheckpointWriter(const std::string &fileName);
+    ~CheckpointWriter();
+
+    inline const std::string &fileName() const
+    { return m_fileName; }
+
+    void submit(Checkpoint &cp);
+    void flush();
+
+private:
+    CheckpointWriter(const CheckpointWriter &) = delete;
+    CheckpointWriter &operator=(const CheckpointWriter &) = delete;
+
+    void run();
+
+    const std::string m_fileName;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    Checkpoint m_pending; /**< next checkpoint to write */
+    Checkpoint m_writing; /**< checkpoint the thread is writing */
+    bool m_hasPending;
+    bool m_busy;
+    bool m_stop;
+    std::thread m_thread;
+};
+
+#endif // CHECKPOINT_H_
@@ -2,10 +2,14 @@
 #define CONSTANTS_H_
 
 constexpr double H   = 5;             /**< ODE solver: maximum step size */
+constexpr double ODE_TOL = 1e-2;      /**< ODE solver: tolerance of the adaptive step size control */
+constexpr double ODE_MAX_STEP = 20*H; /**< ODE solver: maximum step size of the adaptive step size control */
+constexpr int ODE_MAX_REJECT = 10;    /**< ODE solver: maximum rejected steps in a row (adaptive solver) */
 constexpr int    T   = 150;              /**< ODE solver: maximum iterations */
 constexpr int    N   = AR_NUM_REC_ANGL; /**< Radontransform: maximum number of recording angles used */
 constexpr double PHI = 180.0;           /**< Radontransform: highest possible recording angle [deg] */
 constexpr double X0_C = 0.01;           /**< ODE Solver: constant used as initial value for X0 matrix */
+constexpr int    ML_GRID = 64;          /**< Multilevel: grid size of the coarsest level */
 constexpr double DELTA = AR_DELTA;      /**< Inverse Problem: data pertubation */
 constexpr double TAU = 2.0;             /**< Inverse Problem: morozov's diskrepancy */
 
@@ -0,0 +1,197 @@
+#include "datasetstream.h"
+
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <thread>
+
+#include "logger.h"
+
+DataSetStream::DataSetStream(int angles, int numSamples)
+    : m_angles(angles),
+      m_numSamples(numSamples),
+      m_received(angles, false),
+      m_receivedCount(0),
+      m_closed(false)
+{
+}
+
+/**
+ * @brief Queues projection @a y of recording angle @a angle.
+ * A projection sent again replaces the former one.
+ * @return @c false if @a angle or the size of @a y do not fit or the stream
+ * is closed already.
+ */
+bool DataSetStream::push(int angle, const RowVectorXd &y)
+{
+    if ((angle < 0) || (angle >= m_angles) || (y.size() != m_numSamples))
+        return false;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_closed)
+            return false;
+
+        m_pending.emplace_back(angle, y);
+        if (!m_received[angle]) {
+            m_received[angle] = true;
+            ++m_receivedCount;
+        }
+    }
+
+    m_cond.notify_all();
+    return true;
+}
+
+/**
+ * @brief Marks the end of the stream, e.g. when the acquisition is done.
+ */
+void DataSetStream::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closed = true;
+    }
+
+    m_cond.notify_all();
+}
+
+/**
+ * @brief Returns @c true if no more projections will be taken by take().
+ */
+bool DataSetStream::isClosed() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_closed && m_pending.empty();
+}
+
+/**
+ * @brief Moves all queued projections to @a out (which is cleared before).
+ * @param waitMsec If nothing is queued, blocks up to @a waitMsec milliseconds
+ * until a projection arrives or the stream is closed.
+ * @return @c false if nothing was taken.
+ */
+bool DataSetStream::take(std::vector<Projection> *out, int waitMsec)
+{
+    out->clear();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (waitMsec > 0) {
+        m_cond.wait_for(lock, std::chrono::milliseconds(waitMsec),
+                        [this]() { return !m_pending.empty() || m_closed; });
+    }
+
+    out->swap(m_pending);
+    return !out->empty();
+}
+
+/**
+ * @brief Reads projections from @a in until end of file or close(), for pipes
+ * or whole files. Lines which cannot be parsed are skipped. The stream is not
+ * closed.
+ * @return Number of projections read.
+ */
+int DataSetStream::read(std::istream &in)
+{
+    int count = 0;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (parseLine(line))
+            ++count;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_closed)
+            break;
+    }
+
+    return count;
+}
+
+/**
+ * @brief Reads projections from a file which is still being appended.
+ * At the end of the file it waits @a pollMsec milliseconds and tries again,
+ * until projections of all angles were received or close() was called.
+ * Only complete lines (terminated by '\n') are parsed.
+ * @return Number of projections read, -1 if the file cannot be opened.
+ */
+int DataSetStream::follow(const std::string &fileName, int pollMsec)
+{
+    std::ifstream in(fileName);
+    if (!in.is_open())
+        return -1;
+
+    int count = 0;
+    std::string line, partial;
+    for (;;) {
+        while (std::getline(in, line)) {
+            if (in.eof()) { // no '\n' yet, line is still being written
+                partial += line;
+                break;
+            }
+
+            if (parseLine(partial + line))
+                ++count;
+            partial.clear();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_closed || (m_receivedCount == m_angles))
+                break;
+        }
+
+        in.clear(); // reset eof, the file may grow
+        std::this_thread::sleep_for(std::chrono::milliseconds(pollMsec));
+    }
+
+    return count;
+}
+
+/**
+ * @brief Parses one line of the text format and pushes its projection.
+ * Empty lines are skipped, malformed ones are logged as warning and skipped.
+ */
+bool DataSetStream::parseLine(const std::string &line)
+{
+    auto reject = [&line](const char *reason) {
+        const std::size_t maxText = 60; // lines hold up to MaxNumSamples values
+        std::string text = line.substr(0, maxText);
+        if (line.size() > maxText)
+            text += "...";
+
+        Logger::log(Logger::Warning, "stream", std::string("Skipping projection, ") + reason
+                    + ": \"" + text + "\"", {{"reason", reason}});
+        return false;
+    };
+
+    const char *str = line.c_str();
+    while (std::isspace(static_cast<unsigned char>(*str)))
+        ++str;
+    if (*str == '\0')
+        return false; // empty line
+
+    char *end;
+    long angle = std::strtol(str, &end, 10);
+    if (end == str)
+        return reject("no angle index");
+    if ((angle < 0) || (angle >= m_angles)) // also before narrowing to int
+        return reject("angle index out of range");
+
+    RowVectorXd y(m_numSamples);
+    for (int j = 0; j < m_numSamples; ++j) {
+        if (*end != ',')
+            return reject("too few samples");
+        str = end + 1;
+        y(j) = std::strtod(str, &end);
+        if (end == str)
+            return reject("invalid sample");
+    }
+
+    while (std::isspace(static_cast<unsigned char>(*end))) // also '\r' of CRLF files
+        ++end;
+    if (*end != '\0')
+        return reject("too many samples");
+
+    return push(static_cast<int>(angle), y);
+}
@@ -0,0 +1,63 @@
+#ifndef DATASETSTREAM_H_
+#define DATASETSTREAM_H_
+
+#include <condition_variable>
+#include <istream>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "eigen.h"
+
+/**
+ * @brief Queue of measured projections y_n arriving one angle at a time.
+ * A producer (e.g. a reader thread running read() or follow()) pushes the
+ * projections, AsymRegEngine::regularize() takes them over between two
+ * iterations. After close() no more projections are expected, the regulariser
+ * then finishes with the angles received so far.
+ *
+ * The text format read by read() and follow() is one projection per line:
+ * the index of the recording angle followed by its samples, comma separated:
+ *   n,y_n(s_0),y_n(s_1),...
+ */
+class DataSetStream
+{
+public:
+    typedef std::pair<int, RowVectorXd> Projection;
+
+    DataSetStream(int angles, int numSamples);
+
+    inline int angles() const
+    { return m_angles; }
+
+    inline int numSamples() const
+    { return m_numSamples; }
+
+    bool push(int angle, const RowVectorXd &y);
+    void close();
+    bool isClosed() const;
+
+    bool take(std::vector<Projection> *out, int waitMsec = 0);
+
+    int read(std::istream &in);
+    int follow(const std::string &fileName, int pollMsec = 50);
+
+private:
+    DataSetStream(const DataSetStream &) = delete;
+    DataSetStream &operator=(const DataSetStream &) = delete;
+
+    bool parseLine(const std::string &line);
+
+    const int m_angles;
+    const int m_numSamples;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::vector<Projection> m_pending;
+    std::vector<bool> m_received;
+    int m_receivedCount;
+    bool m_closed;
+};
+
+#endif // DATASETSTREAM_H_
@@ -1,5 +1,7 @@
 #include "duration.h"
 
+#include <sstream>
+
 using std::chrono::duration_cast;
 using std::chrono::microseconds;
 using std::chrono::milliseconds;
@@ -45,6 +47,24 @@ double Duration::value() const
     return 0.0;
 }
 
+/**
+ * @brief Duration in seconds (unit independent, e.g. for structured logs).
+ */
+double Duration::seconds() const
+{
+    return std::chrono::duration<double>(m_dur).count();
+}
+
+/**
+ * @brief Value and unit, e.g. "12.345ms".
+ */
+std::string Duration::toString() const
+{
+    std::ostringstream os;
+    os << value() << unit();
+    return os.str();
+}
+
 const char *Duration::unit() const
 {
     detectUnit();
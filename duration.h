@@ -2,6 +2,7 @@
 #define DURATION_H_
 
 #include <chrono>
+#include <string>
 
 class Duration
 {
@@ -13,6 +14,10 @@ public:
 
     const char *unit() const;
 
+    double seconds() const;
+
+    std::string toString() const;
+
 private:
     enum TimeUnit {
         InvalidUnit = -1,
@@ -1,9 +1,32 @@
 #ifndef EIGEN_IO_H_
 #define EIGEN_IO_H_
 
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <stdexcept>
 #include <istream>
+#include <limits>
 #include <sstream>
+#include <string>
+#include <vector>
+
+// nested, older compilers fail to parse __has_include() in the same #if:
+#if (__cplusplus >= 201703L) && defined(__has_include)
+#  if __has_include(<charconv>)
+#    include <charconv>
+#  endif
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#  define EIGEN_IO_HAVE_MMAP
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
 
 #include <Eigen/Core>
 
@@ -181,6 +204,533 @@ fail_out:
     return s;
 }
 
+namespace internal_io {
+
+#if defined(__cpp_lib_to_chars) && (__cpp_lib_to_chars >= 201611L)
+// locale independent and exact, C++17:
+template<typename Scalar>
+inline const char *parse_scalar(const char *first, const char *last, Scalar &val)
+{
+    std::from_chars_result res = std::from_chars(first, last, val);
+    return (res.ec == std::errc()) ? res.ptr : nullptr;
+}
+#else
+// fallback, uses LC_NUMERIC of the C runtime (Qt keeps it at "C"):
+template<typename Scalar>
+inline const char *parse_scalar(const char *first, const char *, Scalar &val)
+{
+    if (std::isspace(static_cast<unsigned char>(*first)))
+        return nullptr; // strtod() would skip it, from_chars() does not
+
+    char *end;
+    val = static_cast<Scalar>(std::strtod(first, &end));
+    return (end != first) ? end : nullptr;
+}
+#endif
+
+// compares delim with buffer at pos, on mismatch found is set to what is there instead:
+inline bool match_delim(const std::string &buf, std::size_t pos, const std::string &delim,
+                        std::string *found = nullptr)
+{
+    if (buf.compare(pos, delim.size(), delim) == 0)
+        return true;
+
+    if (found != nullptr)
+        *found = buf.substr(pos, delim.size());
+    return false;
+}
+
+// checks whether only suffix and whitespaces are left at pos:
+inline bool at_matrix_end(const std::string &buf, std::size_t pos, const std::string &suffix)
+{
+    if (!match_delim(buf, pos, suffix))
+        return false;
+
+    for (pos += suffix.size(); pos < buf.size(); ++pos) {
+        if (!std::isspace(static_cast<unsigned char>(buf[pos])))
+            return false;
+    }
+    return true;
+}
+
+} // namespace internal_io
+
+/* Binary Matrix Container (*.armx):
+ * ================================
+ * A 64 byte header followed by the coefficients in the given layout, both
+ * in host byte order. The payload starts at offset 64, so a mapped file can be
+ * used as Eigen::Map directly (see MappedMatrixFile).
+ */
+struct BinaryMatrixHeader
+{
+    enum {
+        Version = 1
+    };
+
+    enum ScalarType {
+        Float32 = 1,
+        Float64 = 2
+    };
+
+    enum Layout {
+        ColMajorLayout = 0,
+        RowMajorLayout = 1
+    };
+
+    char magic[4];          // "ARMX"
+    std::uint16_t version;  // Version
+    std::uint8_t scalarType;
+    std::uint8_t layout;
+    std::uint32_t reserved0;
+    std::uint64_t rows;
+    std::uint64_t cols;
+    std::uint64_t checksum; // binary_matrix_checksum() of the payload
+    std::uint8_t reserved[24];
+
+    inline bool hasMagic() const
+    { return std::memcmp(magic, "ARMX", 4) == 0; }
+
+    inline std::size_t scalarSize() const
+    { return (scalarType == Float32) ? 4 : ((scalarType == Float64) ? 8 : 0); }
+};
+
+static_assert(sizeof(BinaryMatrixHeader) == 64, "header has to keep the payload aligned");
+
+namespace internal_io {
+
+template<typename Scalar> struct binary_scalar_type;
+template<> struct binary_scalar_type<float>
+{ enum { value = BinaryMatrixHeader::Float32 }; };
+template<> struct binary_scalar_type<double>
+{ enum { value = BinaryMatrixHeader::Float64 }; };
+
+} // namespace internal_io
+
+// FNV-1a over 64 bit words (and the remaining bytes), fast enough to verify
+// large fields on load:
+inline std::uint64_t binary_matrix_checksum(const void *data, std::size_t bytes)
+{
+    const unsigned char *p = static_cast<const unsigned char *>(data);
+    std::uint64_t hash = 14695981039346656037ULL;
+    std::size_t i = 0;
+    for (; i + 8 <= bytes; i += 8) {
+        std::uint64_t word;
+        std::memcpy(&word, p + i, 8);
+        hash = (hash ^ word) * 1099511628211ULL;
+    }
+    for (; i < bytes; ++i)
+        hash = (hash ^ p[i]) * 1099511628211ULL;
+
+    return hash;
+}
+
+// write matrix/vector as binary container (*.armx) to a stream, e.g. as one
+// block of a larger file. Scalar has to be float or double:
+template<typename Derived>
+std::ostream &export_matrix_binary(std::ostream &s, const DenseBase<Derived> &m)
+{
+    typedef typename Derived::PlainObject PlainObject;
+    typedef typename PlainObject::Scalar Scalar;
+
+    const PlainObject mat = m; // evaluates expressions, keeps layout
+    const std::size_t bytes = mat.size() * sizeof(Scalar);
+
+    BinaryMatrixHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, "ARMX", 4);
+    header.version = BinaryMatrixHeader::Version;
+    header.scalarType = internal_io::binary_scalar_type<Scalar>::value;
+    header.layout = PlainObject::IsRowMajor ? BinaryMatrixHeader::RowMajorLayout
+                                            : BinaryMatrixHeader::ColMajorLayout;
+    header.rows = mat.rows();
+    header.cols = mat.cols();
+    header.checksum = binary_matrix_checksum(mat.data(), bytes);
+
+    s.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    s.write(reinterpret_cast<const char *>(mat.data()), bytes);
+
+    return s;
+}
+
+// export matrix/vector to a binary container (*.armx), Scalar has to be
+// float or double:
+template<typename Derived>
+bool export_matrix_binary(const std::string &fileName, const DenseBase<Derived> &m)
+{
+    std::ofstream fs(fileName, std::ios::out | std::ios::binary | std::ios::trunc);
+    export_matrix_binary(fs, m);
+    fs.close();
+
+    return !fs.fail();
+}
+
+// read-only view of a binary container (*.armx):
+// The file is mapped into memory (read into a buffer where mmap() is not
+// available), so map() gives the coefficients without copying or parsing.
+class MappedMatrixFile
+{
+public:
+    MappedMatrixFile()
+        : m_data(nullptr),
+          m_size(0)
+    {}
+
+    ~MappedMatrixFile()
+    { close(); }
+
+    // open file and check header, size and (if verify is set) checksum,
+    // on failure errorString() tells why. Without verify the payload is not
+    // read, so opening a large field costs no more than the mapping:
+    bool open(const std::string &fileName, bool verify = false)
+    {
+        close();
+
+#ifdef EIGEN_IO_HAVE_MMAP
+        int fd = ::open(fileName.c_str(), O_RDONLY);
+        if (fd < 0)
+            return fail("cannot open file");
+
+        struct stat st;
+        if ((fstat(fd, &st) != 0) || (st.st_size < off_t(sizeof(BinaryMatrixHeader)))) {
+            ::close(fd);
+            return fail("file too small");
+        }
+
+        void *addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd); // mapping stays valid
+        if (addr == MAP_FAILED)
+            return fail("cannot map file");
+
+        m_data = static_cast<const char *>(addr);
+        m_size = st.st_size;
+#else
+        std::ifstream fs(fileName, std::ios::in | std::ios::binary);
+        if (!fs.is_open())
+            return fail("cannot open file");
+
+        fs.seekg(0, std::ios::end);
+        std::streamoff size = fs.tellg();
+        if (size < std::streamoff(sizeof(BinaryMatrixHeader)))
+            return fail("file too small");
+        fs.seekg(0, std::ios::beg);
+
+        m_buffer.resize((size + 7) / 8); // uint64_t keeps payload aligned
+        if (!fs.read(reinterpret_cast<char *>(&m_buffer[0]), size))
+            return fail("cannot read file");
+
+        m_data = reinterpret_cast<const char *>(&m_buffer[0]);
+        m_size = size;
+#endif // EIGEN_IO_HAVE_MMAP
+
+        const BinaryMatrixHeader &h = header();
+        if (!h.hasMagic())
+            return fail("not a binary matrix file (magic 'ARMX' missing)");
+        if (h.version != BinaryMatrixHeader::Version)
+            return fail("unsupported version " + std::to_string(h.version));
+        if (h.scalarSize() == 0)
+            return fail("unknown scalar type " + std::to_string(h.scalarType));
+        if (h.layout > BinaryMatrixHeader::RowMajorLayout)
+            return fail("unknown layout " + std::to_string(h.layout));
+        if ((h.rows > std::uint64_t(std::numeric_limits<Index>::max()))
+                || (h.cols > std::uint64_t(std::numeric_limits<Index>::max())))
+            return fail("matrix dimensions " + std::to_string(h.rows)
+                        + "x" + std::to_string(h.cols) + " too large");
+        // divided, the product of the dimensions may wrap around:
+        const std::size_t payloadSize = m_size - sizeof(BinaryMatrixHeader);
+        if (((h.cols != 0) && (h.rows > payloadSize / h.cols / h.scalarSize()))
+                || (payloadSize != h.rows * h.cols * h.scalarSize()))
+            return fail("file size does not match " + std::to_string(h.rows)
+                        + "x" + std::to_string(h.cols) + " matrix");
+        if (verify && (binary_matrix_checksum(payload(), payloadSize) != h.checksum))
+            return fail("checksum mismatch");
+
+        return true;
+    }
+
+    void close()
+    {
+#ifdef EIGEN_IO_HAVE_MMAP
+        if (m_data != nullptr)
+            munmap(const_cast<char *>(m_data), m_size);
+#else
+        m_buffer.clear();
+#endif // EIGEN_IO_HAVE_MMAP
+        m_data = nullptr;
+        m_size = 0;
+    }
+
+    inline bool isOpen() const
+    { return m_data != nullptr; }
+
+    inline const std::string &errorString() const
+    { return m_error; }
+
+    inline const BinaryMatrixHeader &header() const
+    { return *reinterpret_cast<const BinaryMatrixHeader *>(m_data); }
+
+    inline Index rows() const
+    { return header().rows; }
+
+    inline Index cols() const
+    { return header().cols; }
+
+    // true if map<PlainType>() may be used, i.e. scalar type and layout match:
+    template<typename PlainType>
+    inline bool isMappableAs() const
+    {
+        return isOpen()
+                && (header().scalarType == internal_io::binary_scalar_type<typename PlainType::Scalar>::value)
+                && (bool(header().layout) == bool(PlainType::IsRowMajor));
+    }
+
+    // coefficients without copy, e.g. map<MatrixXd>():
+    template<typename PlainType>
+    inline Map<const PlainType> map() const
+    {
+        eigen_assert(isMappableAs<PlainType>());
+        return Map<const PlainType>(reinterpret_cast<const typename PlainType::Scalar *>(payload()),
+                                    rows(), cols());
+    }
+
+    // copy with conversion of scalar type and layout:
+    template<typename Derived>
+    void copyTo(PlainObjectBase<Derived> &m) const
+    {
+        typedef Matrix<float, Dynamic, Dynamic, ColMajor> MatC32;
+        typedef Matrix<float, Dynamic, Dynamic, RowMajor> MatR32;
+        typedef Matrix<double, Dynamic, Dynamic, ColMajor> MatC64;
+        typedef Matrix<double, Dynamic, Dynamic, RowMajor> MatR64;
+        typedef typename Derived::Scalar Scalar;
+
+        const bool rowMajor = (header().layout == BinaryMatrixHeader::RowMajorLayout);
+        if (header().scalarType == BinaryMatrixHeader::Float32) {
+            if (rowMajor)
+                m = map<MatR32>().template cast<Scalar>();
+            else
+                m = map<MatC32>().template cast<Scalar>();
+        } else {
+            if (rowMajor)
+                m = map<MatR64>().template cast<Scalar>();
+            else
+                m = map<MatC64>().template cast<Scalar>();
+        }
+    }
+
+private:
+    MappedMatrixFile(const MappedMatrixFile &) = delete;
+    MappedMatrixFile &operator=(const MappedMatrixFile &) = delete;
+
+    inline const char *payload() const
+    { return m_data + sizeof(BinaryMatrixHeader); }
+
+    bool fail(const std::string &error)
+    {
+        close();
+        m_error = error;
+        return false;
+    }
+
+    const char *m_data;
+    std::size_t m_size;
+#ifndef EIGEN_IO_HAVE_MMAP
+    std::vector<std::uint64_t> m_buffer;
+#endif // EIGEN_IO_HAVE_MMAP
+    std::string m_error;
+};
+
+// checks whether fileName is a binary container (by its magic):
+inline bool is_binary_matrix_file(const std::string &fileName)
+{
+    char magic[4] = { 0 };
+    std::ifstream fs(fileName, std::ios::in | std::ios::binary);
+    fs.read(magic, 4);
+    return fs && (std::memcmp(magic, "ARMX", 4) == 0);
+}
+
+// export matrix/vector as text (fmt) or as binary container if fileName
+// ends with ".armx":
+template<typename Derived>
+bool export_matrix_file(const std::string &fileName, const DenseBase<Derived> &m, const IOFormat &fmt)
+{
+    const std::string ext = ".armx";
+    if ((fileName.size() >= ext.size())
+            && (fileName.compare(fileName.size() - ext.size(), ext.size(), ext) == 0))
+        return export_matrix_binary(fileName, m);
+
+    std::ofstream fs(fileName, std::ios::out | std::ios::trunc);
+    fs << m.format(fmt);
+    fs.close();
+    return !fs.fail();
+}
+
+// import matrix/vector of unknown size from a whole file:
+// The file is read in one shot and parsed in memory, the dimensions are
+// detected from the content (the number of cols from the first row) and m is
+// resized accordingly. Other than import_matrix() a final rowSeparator and
+// "\r\n" for rowSeparator "\n" are accepted.
+// Returns false if the file cannot be read or a value cannot be parsed,
+// delimiter mismatches throw an IOFormatException (like import_matrix()).
+// Binary containers (*.armx) are detected by their magic and loaded from
+// a mapping, fmt is ignored then.
+template<typename Derived>
+bool import_matrix_file(const std::string &fileName, PlainObjectBase<Derived> &m, const IOFormat &fmt)
+{
+    typedef typename Derived::Scalar Scalar;
+    typedef typename Derived::Index Index;
+
+    if (is_binary_matrix_file(fileName)) {
+        MappedMatrixFile file;
+        if (!file.open(fileName, true)) // the copy reads all data anyway
+            return false;
+        file.copyTo(m);
+        return true;
+    }
+
+    // read file in one shot:
+    std::string buf;
+    {
+        std::ifstream fs(fileName, std::ios::in | std::ios::binary);
+        if (!fs.is_open())
+            return false;
+
+        fs.seekg(0, std::ios::end);
+        std::streamoff size = fs.tellg();
+        if (size < 0)
+            return false;
+        fs.seekg(0, std::ios::beg);
+
+        buf.resize(size);
+        if (size && !fs.read(&buf[0], size))
+            return false;
+    }
+
+    const char *data = buf.c_str(); // null-terminated for strtod() fallback
+    const std::size_t end = buf.size();
+    const bool crlf = (fmt.rowSeparator == "\n");
+    std::string found;
+    std::size_t pos = 0;
+
+    std::vector<Scalar> values;
+    Index rows = 0;
+    Index cols = -1;
+
+    // Matrix Prefix:
+    if (!internal_io::match_delim(buf, pos, fmt.matPrefix, &found)) {
+#ifndef EIGEN_IO_FORMAT_DONT_THROW_EXCEPTIONS
+        throw IOFormatException(IOFormatException::MatPrefixException,
+                                fmt.matPrefix, found);
+#endif // EIGEN_IO_FORMAT_DONT_THROW_EXCEPTIONS
+        return false;
+    }
+    pos += fmt.matPrefix.size();
+
+    // every row starts here:
+    for (;;) {
+        // Row Prefix:
+        pos += fmt.rowPrefix.size(); // just skip appropriate length of chars
+
+        Index c = 0;
+        for (;;) {
+            // Parse value (skip leading blanks and '+' like operator>> does):
+            while ((pos < end) && ((data[pos] == ' ') || (data[pos] == '\t')))
+                ++pos;
+            if ((pos < end) && (data[pos] == '+'))
+                ++pos;
+
+            Scalar val;
+            const char *next = (pos < end) ? internal_io::parse_scalar(data + pos, data + end, val) : nullptr;
+            if (next == nullptr)
+                return false; // not a value, so no IOFormat problem (see import_matrix())
+            pos = next - data;
+            values.push_back(val);
+            ++c;
+
+            if ((cols < 0) || (c < cols)) {
+                // Coeff Separator:
+                if (internal_io::match_delim(buf, pos, fmt.coeffSeparator)) {
+                    pos += fmt.coeffSeparator.size();
+                    continue;
+                }
+                if (cols < 0) // first row ends here
+                    break;
+
+#ifndef EIGEN_IO_FORMAT_DONT_THROW_EXCEPTIONS
+                internal_io::match_delim(buf, pos, fmt.coeffSeparator, &found);
+                throw IOFormatException(IOFormatException::CoeffSeparatorException,
+                                        fmt.coeffSeparator, found, rows, c);
+#endif // EIGEN_IO_FORMAT_DONT_THROW_EXCEPTIONS
+                return false;
+            }
+            break; // c == cols
+        }
+
+        if (cols < 0)
+            cols = c;
+        ++rows;
+
+        // Row Suffix:
+        pos += fmt.rowSuffix.size(); // just skip appropriate length of chars
+
+        // Row Separator (optional after the last row):
+        if (crlf && (pos < end) && (data[pos] == '\r'))
+            ++pos;
+        std::size_t rowEnd = pos;
+        if (internal_io::match_delim(buf, pos, fmt.rowSeparator)) {
+            pos += fmt.rowSeparator.size();
+            pos += fmt.rowSpacer.size(); // just skip the size of a rowSpacer
+        }
+
+        // Matrix Suffix, followed by nothing but whitespaces:
+        if (internal_io::at_matrix_end(buf, pos, fmt.matSuffix))
+            break;
+        if (pos != rowEnd)
+            continue; // next row
+
+        if (internal_io::at_matrix_end(buf, pos, "")) { // data ended without suffix
+#ifndef EIGEN_IO_FORMAT_DONT_THROW_EXCEPTIONS
+            throw IOFormatException(IOFormatException::MatSuffixException,
+                                    fmt.matSuffix, buf.substr(pos));
+#endif // EIGEN_IO_FORMAT_DONT_THROW_EXCEPTIONS
+            return false;
+        }
+
+#ifndef EIGEN_IO_FORMAT_DONT_THROW_EXCEPTIONS
+        internal_io::match_delim(buf, pos, fmt.rowSeparator, &found);
+        throw IOFormatException(IOFormatException::RowSeparatorException,
+                                fmt.rowSeparator, found, rows);
+#endif // EIGEN_IO_FORMAT_DONT_THROW_EXCEPTIONS
+        return false;
+    }
+
+    m = Map<const Matrix<Scalar, Dynamic, Dynamic, RowMajor> >(values.data(), rows, cols);
+
+    return true;
+}
+
+// import matrix/vector of unknown size without copying binary containers:
+// Like import_matrix_file(), but a binary container (*.armx) which is
+// mappable as Derived is left open in file and m is not touched, use
+// file.map<Derived>() as long as file is kept. Other files are read into m
+// (file is closed then). The checksum of a binary container is checked only
+// if verify is set, see MappedMatrixFile::open():
+template<typename Derived>
+bool import_matrix_file(const std::string &fileName, MappedMatrixFile &file,
+                        PlainObjectBase<Derived> &m, const IOFormat &fmt, bool verify = false)
+{
+    file.close();
+    if (!is_binary_matrix_file(fileName))
+        return import_matrix_file(fileName, m, fmt);
+
+    if (!file.open(fileName, verify))
+        return false;
+
+    if (!file.isMappableAs<typename Derived::PlainObject>()) {
+        file.copyTo(m); // other scalar type or layout
+        file.close();
+    }
+    return true;
+}
+
 template<typename Derived>
 class WithFormat2
 {
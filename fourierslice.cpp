@@ -0,0 +1,373 @@
+#include "fourierslice.h"
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef _OPENMP
+#  include <omp.h>
+#endif
+
+#include "funcaccop.h"
+
+/* Period:
+ * =======
+ * The projections are periodized with this period on the s-axis, so the radial
+ * frequencies are rho_t = t/Period. The data of [-1,1] and the Backprojection
+ * on the grid [-1,1]^2 (|s| <= sqrt(2)) need a period > 1 + sqrt(2). */
+static const double Period = 3.;
+
+/* Oversampling, Spread:
+ * =====================
+ * Size of the oversampled grid (times gridSize) and half width of the gaussian
+ * kernel. See Greengard & Lee, "Accelerating the Nonuniform Fast Fourier
+ * Transform", SIAM Review 46 (2004): with 2 and 4 the slices are exact to
+ * about 4 digits, which is well below the discretization error. */
+static const int Oversampling = 2;
+static const int Spread = 4;
+
+static inline int threadNum()
+{
+#ifdef _OPENMP
+    return omp_get_thread_num();
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief Prepares the slices of all recording angles @a Sigma for the samples
+ * @a S of the s-axis on a grid of [@a gridSize x @a gridSize].
+ * @param sampleRate Sample rate of the r-axis of RadonOperator.
+ */
+FourierSlice::FourierSlice(const MatrixXd &Sigma, const RowVectorXd &S, int gridSize, double sampleRate)
+    : m_Sigma(Sigma),
+      m_S(S),
+      m_gridSize(gridSize),
+      m_fftSize(Oversampling * gridSize),
+      m_step(2. / (gridSize - 1))
+{
+    eigen_assert((gridSize > 1) && (S.size() > 1));
+
+    const int N = gridSize;
+    const int M = m_fftSize;
+    const int W = 2 * Spread;
+    const int angles = Sigma.cols();
+    const int numSamples = S.size();
+    const double ds = S(1) - S(0);
+    const double dRho = 1. / Period;
+    const double tau = M_PI * Spread / (double(N) * N * Oversampling * (Oversampling - .5));
+
+    /* radial frequencies up to the Nyquist frequency of the grid: */
+    m_radial = 1 + int(Period / (2. * m_step));
+
+    /* Deconv:
+     * =======
+     * Divides out the Fourier transform of the kernel, including the scaling
+     * of the oversampled FFT. */
+    m_Deconv.resize(N);
+    for (int k = 0; k < N; ++k) {
+        const double kk = k - N/2;
+        m_Deconv(k) = std::exp(kk * kk * tau) * std::sqrt(M_PI / tau) / M;
+    }
+
+    /* Weight:
+     * =======
+     * RadonOperator integrates with the extended trapezoidal rule on m points
+     * of the line of length L, so the line integral is weighted by (m-1)/(m*L).
+     * A single point (L = 0) is looked up directly, see edgeValue(). */
+    m_Weight.resize(numSamples);
+    for (int j = 0; j < numSamples; ++j) {
+        double lower, upper;
+        circleBound(S(j), &lower, &upper);
+        const int m = 1 + (std::abs(lower) + std::abs(upper))/sampleRate;
+        m_Weight(j) = (m > 1) ? (m - 1.) / (m * (upper - lower)) : 0.;
+    }
+
+    /* Exp, Box:
+     * =========
+     * Transform between the samples and the radial frequencies. The negative
+     * frequencies are the complex conjugates of the positive ones, so they are
+     * left out and the others count twice. The Backprojection looks up sample j
+     * for s in [s_j, s_j + ds), which is a box in the Fourier domain. */
+    m_Exp.resize(m_radial, numSamples);
+    m_Box.resize(m_radial);
+    for (int t = 0; t < m_radial; ++t) {
+        const double rho = t * dRho;
+        const double weight = (t > 0) ? 2. * dRho : dRho;
+        for (int j = 0; j < numSamples; ++j)
+            m_Exp(t, j) = std::polar(weight, -2. * M_PI * rho * S(j));
+
+        const double x = M_PI * rho * ds;
+        m_Box(t) = std::polar(ds * ((t > 0) ? std::sin(x) / x : 1.), -x);
+    }
+
+    /* kernel:
+     * =======
+     * The grid index k - N/2 is at (k - N/2 + offset) * step in the target
+     * coord. system, frequency rho * sigma at -theta on the oversampled grid. */
+    const int points = angles * m_radial;
+    const double offset = N/2 - (N - 1) / 2.;
+    const double h = 2. * M_PI / M;
+
+    m_Start.resize(2 * points);
+    m_Kernel1.resize(W, points);
+    m_Kernel2.resize(W, points);
+    m_Shift.resize(points);
+    for (int n = 0; n < angles; ++n) {
+        for (int t = 0; t < m_radial; ++t) {
+            const int p = n * m_radial + t;
+            const double theta[2] = { 2. * M_PI * m_step * t * dRho * Sigma(0, n),
+                                      2. * M_PI * m_step * t * dRho * Sigma(1, n) };
+
+            for (int dim = 0; dim < 2; ++dim) {
+                const double x = -theta[dim];
+                const int first = int(std::floor(x / h)) - Spread + 1;
+                MatrixXd &Kernel = (dim == 0) ? m_Kernel1 : m_Kernel2;
+                for (int a = 0; a < W; ++a) {
+                    const double dist = x - (first + a) * h;
+                    Kernel(a, p) = std::exp(-dist * dist / (4. * tau));
+                }
+                m_Start[2 * p + dim] = ((first % M) + M) % M;
+            }
+
+            m_Shift(p) = std::polar(1., -offset * (theta[0] + theta[1]));
+        }
+    }
+
+    /* gridding lists, every column of the grid is written by one thread only: */
+    m_ColumnStart.assign(M + 1, 0);
+    for (int p = 0; p < points; ++p) {
+        for (int b = 0; b < W; ++b)
+            ++m_ColumnStart[(m_Start[2 * p + 1] + b) % M + 1];
+    }
+    for (int c = 0; c < M; ++c)
+        m_ColumnStart[c + 1] += m_ColumnStart[c];
+
+    std::vector<int> next(m_ColumnStart.begin(), m_ColumnStart.end() - 1);
+    m_ColumnEntry.resize(points * W);
+    for (int p = 0; p < points; ++p) {
+        for (int b = 0; b < W; ++b)
+            m_ColumnEntry[next[(m_Start[2 * p + 1] + b) % M]++] = p * W + b;
+    }
+
+    /* buffers and FFT plans, so transforms do not allocate memory: */
+#ifdef _OPENMP
+    const int threads = omp_get_max_threads();
+#else
+    const int threads = 1;
+#endif
+
+    m_Grid.resize(M, M);
+    m_Slices.setZero(m_radial, angles);
+    m_X.resize(N, N);
+    m_FFT.resize(threads);
+    m_Line.assign(threads, VectorXcd::Zero(M));
+    m_LineOut.assign(threads, VectorXcd::Zero(M));
+    for (int i = 0; i < threads; ++i) {
+        m_FFT[i].SetFlag(FFT<double>::Unscaled);
+        m_FFT[i].fwd(m_LineOut[i].data(), m_Line[i].data(), M);
+        m_FFT[i].inv(m_LineOut[i].data(), m_Line[i].data(), M);
+    }
+}
+
+/**
+ * @brief Fourier transform of the grid data @a X inside the unit disc,
+ * used by project() afterwards.
+ */
+void FourierSlice::transform(const MatrixXd &X)
+{
+    eigen_assert((X.rows() == m_gridSize) && (X.cols() == m_gridSize));
+
+    const int N = m_gridSize;
+    const double center = (N - 1) / 2.;
+
+    m_X = X;
+    m_Grid.setZero();
+
+    #pragma omp parallel for schedule(static)
+    for (int l = 0; l < N; ++l) {
+        const double y = (l - center) * m_step;
+        const int c = gridIndex(l);
+        for (int k = 0; k < N; ++k) {
+            const double x = (k - center) * m_step;
+            if (x*x + y*y <= 1.)
+                m_Grid(gridIndex(k), c) = X(k, l) * m_Deconv(k) * m_Deconv(l);
+        }
+    }
+
+    fft2(false);
+}
+
+/**
+ * @brief Radon-Transform for recording angle @a n of the grid data passed
+ * to transform(). Can be called in parallel for different angles.
+ * @param radon Array which receives numSamples values.
+ */
+void FourierSlice::project(int n, double *radon)
+{
+    const int W = 2 * Spread;
+    const int M = m_fftSize;
+    const double area = m_step * m_step;
+
+    /* slice, interpolated by the kernel: */
+    for (int t = 0; t < m_radial; ++t) {
+        const int p = n * m_radial + t;
+        const int row = m_Start[2 * p];
+
+        Complex sum = 0.;
+        int c = m_Start[2 * p + 1];
+        for (int b = 0; b < W; ++b) {
+            const Complex *column = m_Grid.col(c).data();
+            Complex part = 0.;
+            int r = row;
+            for (int a = 0; a < W; ++a) {
+                part += column[r] * m_Kernel1(a, p);
+                if (++r == M)
+                    r = 0;
+            }
+            sum += part * m_Kernel2(b, p);
+            if (++c == M)
+                c = 0;
+        }
+
+        m_Slices(t, n) = area * m_Shift(p) * sum;
+    }
+
+    /* inverse transform on the s-axis: */
+    for (int j = 0; j < m_S.size(); ++j) {
+        if (m_Weight(j) > 0.)
+            radon[j] = m_Weight(j) * m_Exp.col(j).dot(m_Slices.col(n)).real();
+        else
+            radon[j] = edgeValue(n, j);
+    }
+}
+
+/**
+ * @brief Sets the slices of all angles to zero, angles without projection do
+ * not contribute to backprojectAll().
+ */
+void FourierSlice::clearProjections()
+{
+    m_Slices.setZero();
+}
+
+/**
+ * @brief Sets the data @a proj (numSamples values) to be backprojected for
+ * recording angle @a n. Can be called in parallel for different angles.
+ */
+void FourierSlice::setProjection(int n, const double *proj)
+{
+    auto Slice = m_Slices.col(n);
+    Slice.setZero();
+
+    /* the last sample is never looked up (see BaseInterpol::locate()): */
+    for (int j = 0; j + 1 < m_S.size(); ++j)
+        Slice += proj[j] * m_Exp.col(j);
+
+    Slice = Slice.cwiseProduct(m_Box);
+}
+
+/**
+ * @brief Sum of the Backprojections of all angles set by setProjection().
+ * @param Xout Grid data, will be resized to [gridSize x gridSize].
+ */
+void FourierSlice::backprojectAll(MatrixXd &Xout)
+{
+    const int N = m_gridSize;
+    const int M = m_fftSize;
+    const int W = 2 * Spread;
+
+    /* gridding, column by column in the order of the points: */
+    m_Grid.setZero();
+
+    #pragma omp parallel for schedule(static)
+    for (int c = 0; c < M; ++c) {
+        Complex *column = m_Grid.col(c).data();
+        for (int e = m_ColumnStart[c]; e < m_ColumnStart[c + 1]; ++e) {
+            const int p = m_ColumnEntry[e] / W;
+            const Complex slice = m_Slices.data()[p]; // (t, n) of p = n * m_radial + t
+            if (slice == 0.)
+                continue;
+
+            const Complex coeff = slice * std::conj(m_Shift(p)) * m_Kernel2(m_ColumnEntry[e] % W, p);
+            int r = m_Start[2 * p];
+            for (int a = 0; a < W; ++a) {
+                column[r] += coeff * m_Kernel1(a, p);
+                if (++r == M)
+                    r = 0;
+            }
+        }
+    }
+
+    fft2(true);
+
+    Xout.resize(N, N);
+
+    #pragma omp parallel for schedule(static)
+    for (int l = 0; l < N; ++l) {
+        const int c = gridIndex(l);
+        for (int k = 0; k < N; ++k)
+            Xout(k, l) = m_Deconv(k) * m_Deconv(l) * m_Grid(gridIndex(k), c).real();
+    }
+}
+
+/**
+ * @brief Unscaled 2D FFT of the oversampled grid.
+ * Only the columns of the grid indices hold data (resp. are needed), so the
+ * inverse transform starts with these columns and then does all rows, the
+ * forward transform does all rows and then these columns only.
+ */
+void FourierSlice::fft2(bool forward)
+{
+    const int N = m_gridSize;
+    const int M = m_fftSize;
+
+    #pragma omp parallel
+    {
+        FFT<double> &fft = m_FFT[threadNum()];
+        VectorXcd &Line = m_Line[threadNum()];
+        VectorXcd &Out = m_LineOut[threadNum()];
+
+        for (int pass = 0; pass < 2; ++pass) {
+            if ((pass == 0) != forward) { // columns of grid index l
+                #pragma omp for schedule(static)
+                for (int l = 0; l < N; ++l) {
+                    auto Column = m_Grid.col(gridIndex(l));
+                    Line = Column;
+                    if (forward)
+                        fft.fwd(Column.data(), Line.data(), M);
+                    else
+                        fft.inv(Column.data(), Line.data(), M);
+                }
+            } else {
+                #pragma omp for schedule(static)
+                for (int r = 0; r < M; ++r) {
+                    Line = m_Grid.row(r).transpose();
+                    if (forward)
+                        fft.fwd(Out.data(), Line.data(), M);
+                    else
+                        fft.inv(Out.data(), Line.data(), M);
+                    m_Grid.row(r) = Out.transpose();
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Radon-Transform of a line with a single point (at the edge of the unit
+ * disc), which RadonOperator weights by 1/4 and interpolates bilinearly.
+ */
+double FourierSlice::edgeValue(int n, int j) const
+{
+    const int N = m_gridSize;
+    const double u = (m_S(j) * m_Sigma(0, n) + 1.) / m_step;
+    const double v = (m_S(j) * m_Sigma(1, n) + 1.) / m_step;
+    const int k = std::min(std::max(int(u), 0), N - 2);
+    const int l = std::min(std::max(int(v), 0), N - 2);
+    const double a = u - k;
+    const double b = v - l;
+
+    return .25 * ((1. - a) * (1. - b) * m_X(k, l) + a * (1. - b) * m_X(k + 1, l)
+                  + (1. - a) * b * m_X(k, l + 1) + a * b * m_X(k + 1, l + 1));
+}
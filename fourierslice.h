@@ -0,0 +1,97 @@
+#ifndef FOURIERSLICE_H_
+#define FOURIERSLICE_H_
+
+#include "eigen.h"
+
+#include <unsupported/Eigen/FFT>
+
+#include <complex>
+#include <vector>
+
+/**
+ * @brief Radon Operator and Backprojection by the Fourier slice theorem.
+ * The 1D Fourier transform of the projection for angle sigma is the slice of
+ * the 2D Fourier transform of the grid data along sigma. So one 2D FFT per
+ * grid yields the projections of all angles: transform() does the FFT,
+ * project() interpolates the radial slice of one angle and transforms it back
+ * to the samples of the s-axis.
+ * The adjoint goes the other way round: setProjection() transforms the data of
+ * one angle to its radial slice, backprojectAll() grids the slices of all
+ * angles onto the Cartesian frequencies and sums them up by one inverse 2D FFT.
+ * Both cost O(N^2 log N) per grid instead of O(angles * N^2) for the
+ * pixel-driven Backprojection of every angle.
+ *
+ * The slices are interpolated by a gaussian kernel on a twice oversampled
+ * grid (non-uniform FFT), which is exact to about 1e-4. The projections are
+ * scaled like RadonOperator (trapezoidal weights of the line through the unit
+ * disc), the Backprojection looks up the samples like TrgtFuncAccOp<Projection>.
+ * The result is band-limited to the grid, so it reproduces the sampled
+ * operators up to their discretization: see asymreg.cpp for the tolerance.
+ *
+ * The grid data is not restricted to the unit disc by the Backprojection, but
+ * by the Radon Operator.
+ */
+class FourierSlice
+{
+public:
+    FourierSlice(const MatrixXd &Sigma, const RowVectorXd &S, int gridSize, double sampleRate);
+
+    inline int angles() const
+    { return m_Sigma.cols(); }
+
+    inline int numSamples() const
+    { return m_S.size(); }
+
+    inline int gridSize() const
+    { return m_gridSize; }
+
+    void transform(const MatrixXd &X);
+
+    void project(int n, double *radon);
+
+    void clearProjections();
+
+    void setProjection(int n, const double *proj);
+
+    void backprojectAll(MatrixXd &Xout);
+
+private:
+    typedef std::complex<double> Complex;
+
+    void fft2(bool forward);
+
+    /* index of grid index k on the oversampled grid (frequency k - N/2): */
+    inline int gridIndex(int k) const
+    { return (k - m_gridSize/2 + m_fftSize) % m_fftSize; }
+
+    double edgeValue(int n, int j) const;
+
+    MatrixXd m_Sigma;
+    RowVectorXd m_S;
+    int m_gridSize;
+    int m_fftSize;    /**< size of the oversampled grid */
+    int m_radial;     /**< number of radial frequencies, without the negative ones */
+    double m_step;    /**< grid step in target coord. system */
+
+    VectorXd m_Deconv;      /**< deconvolution of the kernel, one per grid index */
+    VectorXd m_Weight;      /**< trapezoidal weight of the line of each sample */
+    MatrixXcd m_Exp;        /**< weighted exp(-2 pi i rho_t s_j), one column per sample */
+    VectorXcd m_Box;        /**< Fourier transform of the sample lookup */
+
+    /* kernel of every point rho_t * sigma_n, index p = n * m_radial + t: */
+    std::vector<int> m_Start; /**< first row and column of the kernel */
+    MatrixXd m_Kernel1;       /**< kernel weights of the rows, one column per point */
+    MatrixXd m_Kernel2;       /**< kernel weights of the columns, one column per point */
+    VectorXcd m_Shift;        /**< phase of the grid offset */
+    std::vector<int> m_ColumnStart; /**< gridding: points of every column of the grid */
+    std::vector<int> m_ColumnEntry; /**< gridding: point * kernel width + column in kernel */
+
+    MatrixXcd m_Grid;       /**< oversampled grid, frequencies resp. spatial domain */
+    MatrixXcd m_Slices;     /**< radial slice of each angle, one column per angle */
+    MatrixXd m_X;           /**< grid data of the last transform() */
+    std::vector<FFT<double> > m_FFT;      /**< one per thread */
+    std::vector<VectorXcd> m_Line;        /**< one per thread */
+    std::vector<VectorXcd> m_LineOut;     /**< one per thread */
+};
+
+#endif // FOURIERSLICE_H_
@@ -0,0 +1,276 @@
+#ifndef FUNCACCOP_H_
+#define FUNCACCOP_H_
+
+#include <algorithm>
+#include <cmath>
+
+#include "backprojection.h"
+#include "eigen.h"
+#include "interpol.h"
+
+/*
+ * Accessors which connect the Radon Operator and the Backprojection with the
+ * interpolated data, including the transformation between target coord.
+ * system (r,s) and physical coord. system (x,y). Used by AsymRegEngine and the
+ * benchmarks (test/benchmark).
+ */
+
+/**
+ * @brief Returns the integration boundaries of the unit disc for Radon-Transform.
+ * @param in s-value of the line.
+ * @param lower Pointer to lower boundary variable.
+ * @param upper Pointer to upper boundary variable.
+ */
+inline void circleBound(double in, double *lower, double *upper)
+{
+    double val = sqrt(1 - in*in);
+    *lower = -val;
+    *upper =  val;
+}
+
+/**
+ * @brief Returns [-1,1] as integration boundaries for Radon-Transform.
+ * @param in (unused)
+ * @param lower Pointer to lower boundary variable.
+ * @param upper Pointer to upper boundary variable.
+ */
+inline void squareBound(double /*in*/, double *lower, double *upper)
+{
+    *lower = -1.;
+    *upper = 1.;
+}
+
+/**
+ * @brief Little helper class to transform coordinates from target
+ *        to physical coord. system and get data from AsymRegEngine::sourceFunction().
+ */
+class SrcFuncAccOp {
+public:
+    SrcFuncAccOp(BilinearInterpol *func)
+        : m_func(func) {}
+
+    /**
+     * @brief Pass a 2D vector or 'list' of 2D vectors and get source-function data in return.
+     * The given points @a pts are supposed to be in the target coord. system and are
+     * therefore transformed as described below in the code.
+     * After that the BilinearInterpol class is queried for all points (batched, see
+     * BilinearInterpol::interpol()) and the values are returned as a vector.
+     * @param pts 2D Vector or Matrix/Array where each column represents a 2D Vector
+     * @return Row-Vector with data values
+     */
+    template <typename Derived>
+    Matrix<typename Derived::Scalar, 1, Dynamic> operator()(const EigenBase<Derived> &pts) const
+    {
+        typedef typename Derived::Scalar Scalar;
+
+        EIGEN_STATIC_ASSERT(Derived::RowsAtCompileTime == 2,
+                            THIS_METHOD_IS_ONLY_FOR_OBJECTS_OF_A_SPECIFIC_SIZE);
+
+        /* translate pts to phys. coord. system: */
+        Matrix<Scalar, 2, Dynamic> xys = transformation() * pts;
+        eigen_assert((xys.minCoeff() >= 0.0) && (xys.maxCoeff() <= 10.0));
+
+        /* get data from source-function at (x,y), all points at once:*/
+        Matrix<Scalar, 1, Dynamic> ret(xys.cols()); // init with correct size, even if size is 1
+        m_func->interpol(xys, ret);
+
+        return ret;
+    }
+
+    /**
+     * @brief Batched version of operator()(pts) for @a count points, given
+     * column-major like a [2 x count] matrix. The points are transformed in
+     * blocks on the stack, so no memory is allocated.
+     * @param pts Points in target coord. system.
+     * @param count Number of points.
+     * @param ret Array which receives the @a count values.
+     */
+    void operator()(const double *pts, int count, double *ret) const
+    {
+        const int blockSize = 64;
+        double xys[2 * blockSize];
+
+        for (int b = 0; b < count; b += blockSize) {
+            const int n = std::min(blockSize, count - b);
+
+            /* translate pts to phys. coord. system, like transformation() * pts: */
+            Map<Matrix<double, 2, Dynamic> > XYs(xys, 2, n);
+            XYs.colwise() = transformation().translation();
+            XYs.noalias() += transformation().linear().lazyProduct(
+                        Map<const Matrix<double, 2, Dynamic> >(pts + 2 * b, 2, n));
+            eigen_assert((XYs.minCoeff() >= 0.0) && (XYs.maxCoeff() <= 10.0));
+
+            m_func->interpol(xys, n, ret + b);
+        }
+    }
+
+    /**
+     * @brief Pass a 2D vector and get the interpolation stencil of the source-function in return.
+     * The given point @a pt is transformed like in operator()(). The stencil contains the
+     * lower grid indices @a i, @a j and the four weights @a w as described in
+     * BilinearInterpol::stencil().
+     * @param pt 2D Vector in target coord. system
+     */
+    void stencil(const Vector2d &pt, int *i, int *j, double *w) const
+    {
+        Vector2d xy = transformation() * pt;
+        m_func->stencil(xy(0), xy(1), i, j, w);
+    }
+
+private:
+    static const Transform<double, 2, Affine> &transformation()
+    {
+        /* tr:
+         * ===
+         * coordinate transformation from target coord. system (r,s) \in [0,1]^2
+         * to physical coord. system (x,y) = [0,10]^2
+         * We want: tr(r,s) = (x,y)|T = [2,8]^2  for r,s=0,...,1
+         *  => tr(r,s) = (3*r+5, 3*s+5)
+         *
+         * Todo: documents want (r,s) = D^1  (unit disc)
+         */
+        static Transform<double, 2, Affine> tr = Translation2d(5, 5) * Scaling(5.0);
+        return tr;
+    }
+
+    BilinearInterpol *m_func;
+};
+
+template<class Interpol>
+class TrgtFuncAccOp
+{
+public:
+    template <typename Derived>
+    TrgtFuncAccOp(const EigenBase<Derived> &dataValues)
+    {
+        EIGEN_STATIC_ASSERT_VECTOR_ONLY(Derived); // assert if we call c'tor with a matrix
+
+        typedef typename Derived::Scalar Scalar;
+
+        Matrix<Scalar, 1, Dynamic> X =
+                Matrix<Scalar, 1, Dynamic>::LinSpaced(Sequential, dataValues.size(),
+                                                      -1, 1);
+
+        m_interpol = new Interpol(X, dataValues);
+    }
+
+    ~TrgtFuncAccOp()
+    { delete m_interpol; }
+
+    TrgtFuncAccOp(const TrgtFuncAccOp &) = delete;
+    TrgtFuncAccOp &operator=(const TrgtFuncAccOp &) = delete;
+
+    /**
+     * @brief Replaces the data values by @a dataValues of the same size, the
+     * interpolator is kept and overwritten in place (Projection only).
+     */
+    template <typename Derived>
+    void setValues(const DenseBase<Derived> &dataValues)
+    { m_interpol->setValues(dataValues.derived().data()); }
+
+    template <typename Scalar>
+    Scalar operator()(const Scalar s) const
+    {
+        /* check out of bound, SchlierenData is only valid in [-1,1]: */
+        if ((s < -1.) || (s > 1.))
+            return Scalar(0);
+
+        /* get data at s:*/
+        Scalar ret = m_interpol->interpol(s);
+
+        return ret;
+    }
+
+    /**
+     * @brief Batched version of operator()(s) for @a count values.
+     */
+    void operator()(const double *s, int count, double *ret) const
+    {
+        m_interpol->interpol(s, count, ret);
+
+        /* SchlierenData is only valid in [-1,1]: */
+        Map<const ArrayXd> S(s, count);
+        Map<ArrayXd> Ret(ret, count);
+        Ret = ((S < -1.) || (S > 1.)).select(0., Ret);
+    }
+
+private:
+    Interpol *m_interpol;
+};
+
+/**
+ * @brief Transforms the grid @a Xsi x @a Xsi to the axes @a U and @a V used by
+ * backprojectGrid().
+ * The grid points are given in physical coord. system and are transformed to
+ * the target coord. system as described below in the code.
+ * @param Xsi Discrete samples of x- and y-axis (physical coord. system).
+ * @param U Vector which receives the first axis (target coord. system).
+ * @param V Vector which receives the second axis (target coord. system).
+ */
+template <typename Derived>
+void backprojectionAxes(const EigenBase<Derived> &Xsi, VectorXd &U, VectorXd &V)
+{
+    /* trInv:
+     * ======
+     * Inverse coordinate transformation from target coord. system
+     * (r,s) \in [0,1]^2 to physical coord. system (x,y) = [0,10]^2
+     * We want: tr(r,s) = (x,y)|T = [2,8]^2  for r,s=0,...,1
+     *  => tr(r,s) = (3*r+5, 3*s+5)
+     *  => trInv(x,y) = tr.inverse()(x,y) = (0.333*[x-5], 0.333*[y-5])
+     *
+     * Todo: documents want (r,s) = D^1  (unit disc)
+     */
+    static const Transform<double, 2, Affine> trInv = (Translation2d(5, 5) * Scaling(5.0)).inverse();
+    //LOG_MATRIX(trInv);
+
+    /* U, V:
+     * =====
+     * trInv has no rotation, so the transformed grid point (x_k, y_l) is (U(k), V(l)).
+     * Both are computed by trInv itself to get exactly the same values as before.
+     */
+    const int size = Xsi.size();
+    U.resize(size);
+    V.resize(size);
+    for (int k = 0; k < size; ++k) {
+        Vector2d vec = trInv * Vector2d(Xsi.derived()(k), Xsi.derived()(k));
+        U(k) = vec(0);
+        V(k) = vec(1);
+    }
+}
+
+/**
+ * @brief Evaluates the Backprojection @a R_adjoint on every point of the grid
+ * @a U x @a V, see backprojectionAxes(). Does not allocate memory if @a Xout
+ * already has the size of the grid.
+ * @param R_adjoint Backprojection for one recording angle.
+ * @param U Discrete samples of first axis (target coord. system).
+ * @param V Discrete samples of second axis (target coord. system).
+ * @param factor Every backprojected value is multiplied by this factor.
+ * @param Xout Matrix which receives the data, resized to [U x V].
+ */
+template <typename Func>
+void backprojectGrid(Backprojection<Func> &R_adjoint, const VectorXd &U, const VectorXd &V,
+                     const double factor, MatrixXd &Xout)
+{
+    R_adjoint.grid(U, V, Xout);
+    if (factor != 1.)
+        Xout *= factor;
+}
+
+/**
+ * @brief Evaluates the Backprojection @a R_adjoint on every point of the grid @a Xsi x @a Xsi.
+ * @param R_adjoint Backprojection for one recording angle.
+ * @param Xsi Discrete samples of x- and y-axis (physical coord. system).
+ * @param factor Every backprojected value is multiplied by this factor.
+ * @param Xout Matrix which receives the data, resized to [Xsi x Xsi].
+ */
+template <typename Func, typename Derived>
+void backprojectGrid(Backprojection<Func> &R_adjoint, const EigenBase<Derived> &Xsi,
+                            const double factor, MatrixXd &Xout)
+{
+    VectorXd U, V;
+    backprojectionAxes(Xsi, U, V);
+    backprojectGrid(R_adjoint, U, V, factor, Xout);
+}
+
+#endif // FUNCACCOP_H_
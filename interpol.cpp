@@ -3,6 +3,12 @@
 #include <algorithm>
 #include <cmath>
 
+#if defined(__AVX2__)
+#  include <immintrin.h>
+#elif defined(__SSE2__)
+#  include <emmintrin.h>
+#endif
+
 BaseInterpol::BaseInterpol(const Eigen::VectorXd &x, const Eigen::VectorXd &y, int m)
     : m_N(x.size()),
       m_M(m),
@@ -17,6 +23,146 @@ BaseInterpol::BaseInterpol(const Eigen::VectorXd &x, const Eigen::VectorXd &y, i
         throw("hunt/bisect size error");
 
     m_ascending = (x.coeffRef(m_N - 1) >= x.coeffRef(0));
+
+    /* equidistant grid (like LinSpaced()) allows a direct index computation: */
+    const double step = (x.coeffRef(m_N - 1) - x.coeffRef(0)) / (m_N - 1);
+    const double tol = 1.e-10 * std::abs(step);
+    m_uniform = (step != 0.);
+    for (int k = 1; m_uniform && (k < m_N); ++k)
+        m_uniform = std::abs(x.coeffRef(k) - x.coeffRef(k - 1) - step) <= tol;
+    m_invStep = m_uniform ? 1. / step : 0.;
+}
+
+/**
+ * @brief Returns the lower index of the interval containing @a x.
+ * Equidistant grids are looked up in O(1) by uniformIndex(), which does not
+ * touch any member, so one instance can be shared by several threads.
+ * All other grids fall back to hunt() and bisect(), which remember the last
+ * index and are therefore not thread-safe.
+ */
+int BaseInterpol::locate(double x) const
+{
+    if (m_uniform)
+        return uniformIndex(x);
+
+    return m_localIndex ? hunt(x) : bisect(x);
+}
+
+/**
+ * @brief Stateless index lookup for equidistant grids.
+ * The index is computed directly from the grid step and corrected against the
+ * grid points afterwards, so the result is exactly the same as of bisect()
+ * (also for points outside the grid, rounding errors or NaN).
+ */
+int BaseInterpol::uniformIndex(double x) const
+{
+    const double *xd = m_x.data();
+
+    const double t = (x - xd[0]) * m_invStep;
+    int kLower = 0;
+    if (t >= m_N - 2)
+        kLower = m_N - 2;
+    else if (t > 0.)
+        kLower = int(t);
+
+    /* at most one step for each direction, due to rounding: */
+    while ((kLower < m_N - 2) && (x >= xd[kLower + 1] == m_ascending))
+        ++kLower;
+    while ((kLower > 0) && (x < xd[kLower] == m_ascending))
+        --kLower;
+
+    return std::max(0, std::min(m_N - m_M, kLower - ((m_M - 2) >> 1)));
+}
+
+/**
+ * @brief Returns true if uniformIndices() can be used for this grid.
+ */
+bool BaseInterpol::hasUniformIndices() const
+{
+    return m_uniform && m_ascending && (m_M == 2);
+}
+
+/**
+ * @brief Batched version of uniformIndex() for @a count values.
+ * The values are read from @a x with distance @a stride (e.g. 2 for one row
+ * of a 2xN matrix) and the indices are stored in @a k. The estimates are
+ * computed with SSE2/AVX2 and checked against the grid points, lanes which
+ * fail the check (rounding) are redone by uniformIndex(). So the result is
+ * the same as of the scalar version.
+ * Requires hasUniformIndices().
+ */
+void BaseInterpol::uniformIndices(const double *x, int stride, int count, int *k) const
+{
+    const double *xd = m_x.data();
+    int c = 0;
+
+#if defined(__AVX2__)
+    const __m256d x0 = _mm256_set1_pd(xd[0]);
+    const __m256d invStep = _mm256_set1_pd(m_invStep);
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d last = _mm256_set1_pd(m_N - 2);
+
+    for (; c + 4 <= count; c += 4) {
+        const double *p = x + c * stride;
+        __m256d v = _mm256_set_pd(p[3*stride], p[2*stride], p[stride], p[0]);
+
+        /* estimate (NaN ends up at 0, like in uniformIndex()): */
+        __m256d t = _mm256_mul_pd(_mm256_sub_pd(v, x0), invStep);
+        t = _mm256_min_pd(_mm256_max_pd(t, zero), last);
+        __m128i kv = _mm256_cvttpd_epi32(t);
+
+        /* check xd[k] <= v < xd[k+1], with open ends at the boundary: */
+        __m256d kd = _mm256_cvtepi32_pd(kv);
+        __m256d lower = _mm256_i32gather_pd(xd, kv, 8);
+        __m256d upper = _mm256_i32gather_pd(xd + 1, kv, 8);
+        __m256d ok = _mm256_and_pd(
+                    _mm256_or_pd(_mm256_cmp_pd(v, lower, _CMP_GE_OQ), _mm256_cmp_pd(kd, zero, _CMP_EQ_OQ)),
+                    _mm256_or_pd(_mm256_cmp_pd(v, upper, _CMP_NGE_UQ), _mm256_cmp_pd(kd, last, _CMP_EQ_OQ)));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(k + c), kv);
+
+        const int mask = _mm256_movemask_pd(ok);
+        if (mask != 0xf) {
+            for (int l = 0; l < 4; ++l) {
+                if (!(mask & (1 << l)))
+                    k[c + l] = uniformIndex(p[l * stride]);
+            }
+        }
+    }
+#elif defined(__SSE2__)
+    const __m128d x0 = _mm_set1_pd(xd[0]);
+    const __m128d invStep = _mm_set1_pd(m_invStep);
+    const __m128d zero = _mm_setzero_pd();
+    const __m128d last = _mm_set1_pd(m_N - 2);
+
+    for (; c + 2 <= count; c += 2) {
+        const double *p = x + c * stride;
+        __m128d v = _mm_set_pd(p[stride], p[0]);
+
+        /* estimate (NaN ends up at 0, like in uniformIndex()): */
+        __m128d t = _mm_mul_pd(_mm_sub_pd(v, x0), invStep);
+        t = _mm_min_pd(_mm_max_pd(t, zero), last);
+        __m128i kv = _mm_cvttpd_epi32(t);
+
+        const int k0 = _mm_cvtsi128_si32(kv);
+        const int k1 = _mm_cvtsi128_si32(_mm_shuffle_epi32(kv, 1));
+
+        /* check xd[k] <= v < xd[k+1], with open ends at the boundary: */
+        __m128d kd = _mm_cvtepi32_pd(kv);
+        __m128d lower = _mm_set_pd(xd[k1], xd[k0]);
+        __m128d upper = _mm_set_pd(xd[k1 + 1], xd[k0 + 1]);
+        __m128d ok = _mm_and_pd(
+                    _mm_or_pd(_mm_cmpge_pd(v, lower), _mm_cmpeq_pd(kd, zero)),
+                    _mm_or_pd(_mm_cmpnge_pd(v, upper), _mm_cmpeq_pd(kd, last)));
+
+        const int mask = _mm_movemask_pd(ok);
+        k[c]     = (mask & 1) ? k0 : uniformIndex(p[0]);
+        k[c + 1] = (mask & 2) ? k1 : uniformIndex(p[stride]);
+    }
+#endif
+
+    for (; c < count; ++c)
+        k[c] = uniformIndex(x[c * stride]);
 }
 
 int BaseInterpol::hunt(double x) const
@@ -76,8 +222,40 @@ int BaseInterpol::hunt(double x) const
 
 double BaseInterpol::interpol(double x) const
 {
-    int kLower = m_localIndex ? hunt(x) : bisect(x);
-    return rawinterpol(kLower, x);
+    return rawinterpol(locate(x), x);
+}
+
+/**
+ * @brief Interpolates @a count values of @a x at once and stores them in @a y.
+ * Equidistant grids get their indices by uniformIndices() and the values by
+ * rawinterpolBlock(), all other grids are evaluated point by point.
+ */
+void BaseInterpol::interpol(const double *x, int count, double *y) const
+{
+    if (!hasUniformIndices()) {
+        for (int c = 0; c < count; ++c)
+            y[c] = interpol(x[c]);
+        return;
+    }
+
+    const int blockSize = 64;
+    int k[blockSize];
+
+    for (int b = 0; b < count; b += blockSize) {
+        const int n = std::min(blockSize, count - b);
+        uniformIndices(x + b, 1, n, k);
+        rawinterpolBlock(k, x + b, n, y + b);
+    }
+}
+
+/**
+ * @brief Calls rawinterpol() for @a count indices, reimplement this if the
+ * interpolation of a whole block can be done more efficient.
+ */
+void BaseInterpol::rawinterpolBlock(const int *k, const double *x, int count, double *y) const
+{
+    for (int c = 0; c < count; ++c)
+        y[c] = rawinterpol(k[c], x[c]);
 }
 
 int BaseInterpol::bisect(double x) const
@@ -112,30 +290,201 @@ const double *BaseInterpol::yData() const
     return m_y.data();
 }
 
-BilinearInterpol::BilinearInterpol(const Eigen::VectorXd &x1, const Eigen::VectorXd &x2, const Eigen::MatrixXd &y)
+/**
+ * @brief Replaces the data values by the ones at @a y, which has as many
+ * values as the x-axis. The vector is overwritten in place.
+ */
+void BaseInterpol::setYData(const double *y)
+{
+    m_y = Eigen::Map<const Eigen::VectorXd>(y, m_N);
+}
+
+BilinearInterpol::BilinearInterpol(const Eigen::VectorXd &x1, const Eigen::VectorXd &x2, const Eigen::Ref<const Eigen::MatrixXd> &y)
     : m_x1interpol(x1, x1),
       m_x2interpol(x2, x2),
+      m_table(y),
+      m_y(m_table.data(), m_table.rows(), m_table.cols())
+{
+}
+
+/**
+ * @brief Interpolates the grid values @a y in place, they are not copied.
+ * @a owner keeps the memory of @a y alive as long as the interpolator exists,
+ * e.g. a shared MappedMatrixFile.
+ */
+BilinearInterpol::BilinearInterpol(const Eigen::VectorXd &x1, const Eigen::VectorXd &x2, const Eigen::Map<const Eigen::MatrixXd> &y,
+                                   const std::shared_ptr<const void> &owner)
+    : m_x1interpol(x1, x1),
+      m_x2interpol(x2, x2),
+      m_owner(owner),
       m_y(y)
 {
 }
 
 double BilinearInterpol::interpol(double x1, double x2) const
 {
-    int i = m_x1interpol.m_localIndex ? m_x1interpol.hunt(x1) : m_x1interpol.bisect(x1);
-    int j = m_x2interpol.m_localIndex ? m_x2interpol.hunt(x2) : m_x2interpol.bisect(x2);
+    int i, j;
+    double w[4];
+    stencil(x1, x2, &i, &j, w);
 
-    double t = (x1 - m_x1interpol.m_x[i])
-             / (m_x1interpol.m_x[i+1] - m_x1interpol.m_x[i]);
-    double u = (x2 - m_x2interpol.m_x[j])
-             / (m_x2interpol.m_x[j+1] - m_x2interpol.m_x[j]);
-    double y = (1.-t) * (1.-u) * m_y.coeff(i  ,j  )
-             + t      * (1.-u) * m_y.coeff(i+1,j  )
-             + (1.-t) *     u  * m_y.coeff(i  ,j+1)
-             + t      *     u  * m_y.coeff(i+1,j+1);
+    double y = w[0] * m_y.coeff(i  ,j  )
+             + w[1] * m_y.coeff(i+1,j  )
+             + w[2] * m_y.coeff(i  ,j+1)
+             + w[3] * m_y.coeff(i+1,j+1);
 
     return y;
 }
 
+/**
+ * @brief Interpolates all points in @a Pts at once.
+ * Equivalent to calling interpol(x1, x2) for every column, but for
+ * equidistant grids the indices, weights and grid values are computed for
+ * several points at a time with SSE2 (or AVX2 with gathers, if enabled by the
+ * compiler flags). The results are identical to the scalar version.
+ * @param Pts Points, one column per point.
+ * @param Out Row-Vector which receives the values, resized to Pts.cols().
+ */
+void BilinearInterpol::interpol(const Eigen::Matrix<double, 2, Eigen::Dynamic> &Pts, Eigen::RowVectorXd &Out) const
+{
+    Out.resize(Pts.cols());
+    interpol(Pts.data(), Pts.cols(), Out.data());
+}
+
+/**
+ * @brief Interpolates @a n points at once and stores them in @a values,
+ * like interpol(Pts, Out) on plain arrays.
+ * @param pts Points, two coordinates per point (column-major [2 x n]).
+ * @param n Number of points.
+ * @param values Array which receives the @a n values.
+ */
+void BilinearInterpol::interpol(const double *pts, int n, double *values) const
+{
+    if (!m_x1interpol.hasUniformIndices() || !m_x2interpol.hasUniformIndices()) {
+        for (int c = 0; c < n; ++c)
+            values[c] = interpol(pts[2*c], pts[2*c+1]);
+        return;
+    }
+
+    const double *x1d = m_x1interpol.m_x.data();
+    const double *x2d = m_x2interpol.m_x.data();
+    const double *yd = m_y.data();
+    const int ld = m_y.rows();
+
+    const int blockSize = 64;
+    int I[blockSize], J[blockSize]; // lower grid indices
+
+    for (int b = 0; b < n; b += blockSize) {
+        const int count = std::min(blockSize, n - b);
+        const double *p = pts + 2 * b;
+        double *out = values + b;
+
+        m_x1interpol.uniformIndices(p, 2, count, I);
+        m_x2interpol.uniformIndices(p + 1, 2, count, J);
+
+        int c = 0;
+#if defined(__AVX2__)
+        const __m256d one = _mm256_set1_pd(1.);
+        const __m128i vld = _mm_set1_epi32(ld);
+
+        for (; c + 4 <= count; c += 4) {
+            const double *q = p + 2 * c;
+            __m128i vi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(I + c));
+            __m128i vj = _mm_loadu_si128(reinterpret_cast<const __m128i *>(J + c));
+
+            __m256d x1 = _mm256_set_pd(q[6], q[4], q[2], q[0]);
+            __m256d x2 = _mm256_set_pd(q[7], q[5], q[3], q[1]);
+
+            __m256d x1i = _mm256_i32gather_pd(x1d, vi, 8);
+            __m256d x2j = _mm256_i32gather_pd(x2d, vj, 8);
+            __m256d t = _mm256_div_pd(_mm256_sub_pd(x1, x1i),
+                                      _mm256_sub_pd(_mm256_i32gather_pd(x1d + 1, vi, 8), x1i));
+            __m256d u = _mm256_div_pd(_mm256_sub_pd(x2, x2j),
+                                      _mm256_sub_pd(_mm256_i32gather_pd(x2d + 1, vj, 8), x2j));
+            __m256d omt = _mm256_sub_pd(one, t);
+            __m256d omu = _mm256_sub_pd(one, u);
+
+            __m128i idx = _mm_add_epi32(vi, _mm_mullo_epi32(vj, vld)); // column-major index of (i,j)
+            __m256d y = _mm256_mul_pd(_mm256_mul_pd(omt, omu), _mm256_i32gather_pd(yd, idx, 8));
+            y = _mm256_add_pd(y, _mm256_mul_pd(_mm256_mul_pd(t, omu), _mm256_i32gather_pd(yd + 1, idx, 8)));
+            y = _mm256_add_pd(y, _mm256_mul_pd(_mm256_mul_pd(omt, u), _mm256_i32gather_pd(yd + ld, idx, 8)));
+            y = _mm256_add_pd(y, _mm256_mul_pd(_mm256_mul_pd(t, u), _mm256_i32gather_pd(yd + ld + 1, idx, 8)));
+
+            _mm256_storeu_pd(out + c, y);
+        }
+#elif defined(__SSE2__)
+        const __m128d one = _mm_set1_pd(1.);
+
+        for (; c + 2 <= count; c += 2) {
+            const double *q = p + 2 * c;
+            const int i0 = I[c], i1 = I[c + 1];
+            const int j0 = J[c], j1 = J[c + 1];
+            const double *y0 = yd + i0 + j0 * ld;
+            const double *y1 = yd + i1 + j1 * ld;
+
+            /* q = [x1, x2] of first point, q + 2 = [x1, x2] of second point: */
+            __m128d a = _mm_loadu_pd(q);
+            __m128d b = _mm_loadu_pd(q + 2);
+            __m128d x1 = _mm_unpacklo_pd(a, b);
+            __m128d x2 = _mm_unpackhi_pd(a, b);
+
+            __m128d x1i = _mm_set_pd(x1d[i1], x1d[i0]);
+            __m128d x2j = _mm_set_pd(x2d[j1], x2d[j0]);
+            __m128d t = _mm_div_pd(_mm_sub_pd(x1, x1i),
+                                   _mm_sub_pd(_mm_set_pd(x1d[i1 + 1], x1d[i0 + 1]), x1i));
+            __m128d u = _mm_div_pd(_mm_sub_pd(x2, x2j),
+                                   _mm_sub_pd(_mm_set_pd(x2d[j1 + 1], x2d[j0 + 1]), x2j));
+            __m128d omt = _mm_sub_pd(one, t);
+            __m128d omu = _mm_sub_pd(one, u);
+
+            __m128d y = _mm_mul_pd(_mm_mul_pd(omt, omu), _mm_set_pd(y1[0], y0[0]));
+            y = _mm_add_pd(y, _mm_mul_pd(_mm_mul_pd(t, omu), _mm_set_pd(y1[1], y0[1])));
+            y = _mm_add_pd(y, _mm_mul_pd(_mm_mul_pd(omt, u), _mm_set_pd(y1[ld], y0[ld])));
+            y = _mm_add_pd(y, _mm_mul_pd(_mm_mul_pd(t, u), _mm_set_pd(y1[ld + 1], y0[ld + 1])));
+
+            _mm_storeu_pd(out + c, y);
+        }
+#endif
+
+        for (; c < count; ++c) {
+            const int i = I[c], j = J[c];
+            const double t = (p[2*c] - x1d[i]) / (x1d[i+1] - x1d[i]);
+            const double u = (p[2*c+1] - x2d[j]) / (x2d[j+1] - x2d[j]);
+
+            out[c] = (1.-t) * (1.-u) * m_y.coeff(i  ,j  )
+                   + t      * (1.-u) * m_y.coeff(i+1,j  )
+                   + (1.-t) *     u  * m_y.coeff(i  ,j+1)
+                   + t      *     u  * m_y.coeff(i+1,j+1);
+        }
+    }
+}
+
+/**
+ * @brief Returns the interpolation stencil at (@a x1, @a x2).
+ * The interpolated value is the weighted sum of the four grid values
+ * y(i,j), y(i+1,j), y(i,j+1) and y(i+1,j+1) using the weights w[0..3] in
+ * this order. This allows to bake the interpolation into a linear operator.
+ * @param x1 First coordinate.
+ * @param x2 Second coordinate.
+ * @param i Pointer to lower grid index of first coordinate.
+ * @param j Pointer to lower grid index of second coordinate.
+ * @param w Pointer to array of 4 weights.
+ */
+void BilinearInterpol::stencil(double x1, double x2, int *i, int *j, double *w) const
+{
+    *i = m_x1interpol.locate(x1);
+    *j = m_x2interpol.locate(x2);
+
+    double t = (x1 - m_x1interpol.m_x[*i])
+             / (m_x1interpol.m_x[*i+1] - m_x1interpol.m_x[*i]);
+    double u = (x2 - m_x2interpol.m_x[*j])
+             / (m_x2interpol.m_x[*j+1] - m_x2interpol.m_x[*j]);
+
+    w[0] = (1.-t) * (1.-u);
+    w[1] = t      * (1.-u);
+    w[2] = (1.-t) *     u;
+    w[3] = t      *     u;
+}
+
 LinearInterpol::LinearInterpol(const Eigen::VectorXd &x, const Eigen::VectorXd &y)
     : BaseInterpol(x, y, 2)
 {
@@ -162,6 +511,13 @@ double Projection::rawinterpol(int k, double /*x*/) const
     return yData()[k];
 }
 
+void Projection::rawinterpolBlock(const int *k, const double * /*x*/, int count, double *y) const
+{
+    const double *yd = yData();
+    for (int c = 0; c < count; ++c)
+        y[c] = yd[k[c]]; // gather
+}
+
 SplineInterpol::SplineInterpol(const Eigen::VectorXd &x, const Eigen::VectorXd &y, double yp1, double ypn)
     : BaseInterpol(x, y, 2),
       m_y2(x.size())
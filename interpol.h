@@ -1,22 +1,35 @@
 #ifndef INTERPOL_H_
 #define INTERPOL_H_
 
+#include <memory>
+
 #include "eigen.h"
 
 class BaseInterpol
 {
 public:
     BaseInterpol(const Eigen::VectorXd &x, const Eigen::VectorXd &y, int m);
+    virtual ~BaseInterpol() {}
 
     double interpol(double x) const;
+    void interpol(const double *x, int count, double *y) const;
+
+    inline bool isUniform() const
+    { return m_uniform; }
 
 protected:
     virtual double rawinterpol(int k, double x) const = 0;
+    virtual void rawinterpolBlock(const int *k, const double *x, int count, double *y) const;
 
     inline const double *xData() const;
     inline const double *yData() const;
+    void setYData(const double *y);
 
 private:
+    int locate(double x) const;
+    int uniformIndex(double x) const;
+    bool hasUniformIndices() const;
+    void uniformIndices(const double *x, int stride, int count, int *k) const;
     int hunt(double x) const;
     int bisect(double x) const;
 
@@ -28,6 +41,8 @@ private:
     int m_M;
     int m_N;
     bool m_ascending;
+    bool m_uniform;
+    double m_invStep;
 
     friend class BilinearInterpol;
 };
@@ -46,8 +61,12 @@ class Projection : public BaseInterpol
 public:
     Projection(const Eigen::VectorXd &x, const Eigen::VectorXd &y);
 
+    inline void setValues(const double *y)
+    { setYData(y); }
+
 protected:
     virtual double rawinterpol(int k, double x) const;
+    virtual void rawinterpolBlock(const int *k, const double *x, int count, double *y) const;
 };
 
 class SplineInterpol : public BaseInterpol
@@ -67,14 +86,41 @@ private:
 class BilinearInterpol
 {
 public:
-    BilinearInterpol(const Eigen::VectorXd &x1, const Eigen::VectorXd &x2, const Eigen::MatrixXd &y);
+    BilinearInterpol(const Eigen::VectorXd &x1, const Eigen::VectorXd &x2, const Eigen::Ref<const Eigen::MatrixXd> &y);
+    BilinearInterpol(const Eigen::VectorXd &x1, const Eigen::VectorXd &x2, const Eigen::Map<const Eigen::MatrixXd> &y,
+                     const std::shared_ptr<const void> &owner);
 
     double interpol(double x1, double x2) const;
+    void interpol(const Eigen::Matrix<double, 2, Eigen::Dynamic> &Pts, Eigen::RowVectorXd &Out) const;
+    void interpol(const double *pts, int n, double *values) const;
+
+    /**
+     * @brief Replaces the grid values by @a y, which must have the same size.
+     * The table is overwritten in place, so an interpolator can be reused for
+     * every new grid without allocating memory. Not available for shared
+     * grid values.
+     */
+    template <typename Derived>
+    void setValues(const Eigen::MatrixBase<Derived> &y)
+    {
+        eigen_assert(!m_owner && (y.rows() == m_table.rows()) && (y.cols() == m_table.cols()));
+        m_table = y.template cast<double>();
+    }
+
+    void stencil(double x1, double x2, int *i, int *j, double *w) const;
+
+    inline bool isUniform() const
+    { return m_x1interpol.isUniform() && m_x2interpol.isUniform(); }
 
 private:
+    BilinearInterpol(const BilinearInterpol &) = delete;
+    BilinearInterpol &operator=(const BilinearInterpol &) = delete;
+
     LinearInterpol m_x1interpol;
     LinearInterpol m_x2interpol;
-    Eigen::MatrixXd m_y;
+    Eigen::MatrixXd m_table;             // own copy of the grid values, empty if shared
+    std::shared_ptr<const void> m_owner; // keeps shared grid values alive
+    Eigen::Map<const Eigen::MatrixXd> m_y; // grid values, m_table or shared ones
 };
 
 #endif // INTERPOL_H_
@@ -0,0 +1,164 @@
+#include "logger.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+
+static const char *levelNames[] = { "error", "warning", "info", "verbose", "debug" };
+
+static std::atomic<int> currentLevel(Logger::Info);
+static std::mutex logMutex;
+static std::ofstream jsonSink;
+static const auto startTime = std::chrono::steady_clock::now();
+
+// private functions:
+static void writeJsonString(std::ostream &os, const std::string &str);
+static void writeJsonNumber(std::ostream &os, double value);
+
+// function implementations:
+Logger::Field::Field(const char *key, double value)
+    : key(key), isNumber(true), number(value)
+{}
+
+Logger::Field::Field(const char *key, int value)
+    : key(key), isNumber(true), number(value)
+{}
+
+Logger::Field::Field(const char *key, const char *value)
+    : key(key), isNumber(false), number(0.), text(value)
+{}
+
+Logger::Field::Field(const char *key, const std::string &value)
+    : key(key), isNumber(false), number(0.), text(value)
+{}
+
+void Logger::setLevel(Level level)
+{
+    currentLevel = level;
+}
+
+Logger::Level Logger::level()
+{
+    return Level(currentLevel.load(std::memory_order_relaxed));
+}
+
+/**
+ * @brief Converts @a name ("error", "warning", "info", "verbose" or "debug") to a level.
+ * @return @c false if @a name is unknown.
+ */
+bool Logger::parseLevel(const std::string &name, Level *lvl)
+{
+    for (int i = Error; i <= Debug; ++i) {
+        if (name == levelNames[i]) {
+            *lvl = Level(i);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Opens @a fileName as JSON-lines sink, an open sink is closed before.
+ */
+bool Logger::openJsonSink(const std::string &fileName)
+{
+    std::lock_guard<std::mutex> lock(logMutex);
+    if (jsonSink.is_open())
+        jsonSink.close();
+
+    jsonSink.open(fileName, std::ofstream::out | std::ofstream::trunc);
+    jsonSink.precision(17);
+    return jsonSink.is_open();
+}
+
+void Logger::closeJsonSink()
+{
+    std::lock_guard<std::mutex> lock(logMutex);
+    jsonSink.close();
+}
+
+/**
+ * @brief Logs an entry if @a lvl is enabled.
+ * @param lvl Level of the entry.
+ * @param event Short name of the entry's kind, e.g. "iteration".
+ * @param text Line written to stdout, nothing is written if empty.
+ * @param fields Values of the JSON object, besides time, level, event and text.
+ */
+void Logger::log(Level lvl, const char *event, const std::string &text,
+                 std::initializer_list<Field> fields)
+{
+    if (!isEnabled(lvl))
+        return;
+
+    std::lock_guard<std::mutex> lock(logMutex);
+
+    if (!text.empty())
+        std::cout << text << std::endl;
+
+    if (!jsonSink.is_open())
+        return;
+
+    std::chrono::duration<double> t = std::chrono::steady_clock::now() - startTime;
+    jsonSink << "{\"t\":";
+    writeJsonNumber(jsonSink, t.count());
+    jsonSink << ",\"level\":\"" << levelNames[lvl] << "\",\"event\":";
+    writeJsonString(jsonSink, event);
+    if (!text.empty()) {
+        jsonSink << ",\"msg\":";
+        writeJsonString(jsonSink, text);
+    }
+    for (const Field &f : fields) {
+        jsonSink << ',';
+        writeJsonString(jsonSink, f.key);
+        jsonSink << ':';
+        if (f.isNumber)
+            writeJsonNumber(jsonSink, f.number);
+        else
+            writeJsonString(jsonSink, f.text);
+    }
+    jsonSink << '}' << '\n';
+    jsonSink.flush();
+}
+
+void writeJsonString(std::ostream &os, const std::string &str)
+{
+    os << '"';
+    for (unsigned char c : str) {
+        switch (c) {
+        case '"':
+            os << "\\\"";
+            break;
+        case '\\':
+            os << "\\\\";
+            break;
+        case '\n':
+            os << "\\n";
+            break;
+        case '\t':
+            os << "\\t";
+            break;
+        default:
+            if (c < 0x20) {
+                char esc[8];
+                std::snprintf(esc, sizeof(esc), "\\u%04x", c);
+                os << esc;
+            } else {
+                os << c;
+            }
+        }
+    }
+    os << '"';
+}
+
+void writeJsonNumber(std::ostream &os, double value)
+{
+    if (std::isfinite(value))
+        os << value;
+    else
+        os << "null"; // JSON knows no NaN or infinity
+}
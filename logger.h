@@ -0,0 +1,56 @@
+#ifndef LOGGER_H_
+#define LOGGER_H_
+
+#include <initializer_list>
+#include <string>
+
+/**
+ * Process-wide logging with verbosity levels.
+ * Messages up to the current level() are written as text lines to stdout and,
+ * if a sink is opened by openJsonSink(), as one JSON object per line to that
+ * file. Writing is serialized, so engines running in parallel may log.
+ * Expensive output (e.g. whole matrices) should be guarded by isEnabled().
+ */
+namespace Logger {
+
+enum Level {
+    Error,   /**< failures only */
+    Warning, /**< skipped input, e.g. malformed measurements */
+    Info,    /**< timings and per-iteration errors (default) */
+    Verbose, /**< setup of a run, stop reasons */
+    Debug    /**< bulk data like data sets and source matrices */
+};
+
+/**
+ * @brief Named value of a structured log entry.
+ */
+struct Field
+{
+    Field(const char *key, double value);
+    Field(const char *key, int value);
+    Field(const char *key, const char *value);
+    Field(const char *key, const std::string &value);
+
+    const char *key;
+    bool isNumber;
+    double number;
+    std::string text;
+};
+
+void setLevel(Level level);
+Level level();
+
+inline bool isEnabled(Level lvl)
+{ return lvl <= level(); }
+
+bool parseLevel(const std::string &name, Level *lvl);
+
+bool openJsonSink(const std::string &fileName);
+void closeJsonSink();
+
+void log(Level lvl, const char *event, const std::string &text,
+         std::initializer_list<Field> fields = {});
+
+} // namespace Logger
+
+#endif // LOGGER_H_
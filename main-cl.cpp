@@ -1,11 +1,18 @@
 #include <iostream>
-#include <fstream>
+#include <memory>
+#include <sstream>
 #include <string>
+#include <thread>
 
 #include "asymreg.h"
+#include "checkpoint.h"
+#include "datasetstream.h"
 #include "duration.h"
+#include "logger.h"
 #include "plotter.h"
 #include "plottersettings.h"
+#include "profiler.h"
+#include "sweep.h"
 
 #define DATA_FILE  "../data/data-circle-30x30.csv" // TODO: read from QSettings? or from argv?
 //#define DATA_FILE  "../data/recang-testdata-10x10.csv" // TODO: read from QSettings? or from argv?
@@ -14,60 +21,141 @@
 using ts = std::string; // ts (ToString) is much shorter
 
 // private functions:
-static inline void print(const std::string &text = "");
+static bool parse_options(int *argc, char **argv, std::string *streamFile,
+                          std::string *checkpointFile, std::string *resumeFile,
+                          bool *verifyData);
 static inline void print_begin();
 static inline void print_end();
 static inline void print_line(const std::string &text = "");
-static inline void print_line_begin(const std::string &text = "");
-static inline void print_line_end(const std::string &text = "");
 static void set_fpu (unsigned int mode);
 
 // function implementations:
 int main(int argc, char **argv)
 {
     //set_fpu(0x270); // use double-precision rounding
+
+    std::string streamFile; // measured data sets instead of generated ones
+    std::string checkpointFile; // written while regularizing
+    std::string resumeFile; // run to continue instead of a new one
+    bool verifyData = false; // checksum of *.armx source data
+    if (!parse_options(&argc, argv, &streamFile, &checkpointFile, &resumeFile, &verifyData))
+        return 1;
+
+    if ((argc > 1) && (!checkpointFile.empty() || !resumeFile.empty())) {
+        std::cerr << "--checkpoint and --resume are not available for sweeps" << std::endl;
+        return 1;
+    }
+
+    if (!streamFile.empty() && !resumeFile.empty()) {
+        std::cerr << "--resume takes the data sets of the checkpoint, not from --stream" << std::endl;
+        return 1;
+    }
+
+    if (argc > 1) { // sweep over a parameter grid
+        SweepSpec spec;
+        spec.verifyData = verifyData;
+        std::string error;
+        if (!spec.parse(argc, argv, &error)) {
+            std::cerr << error << std::endl;
+            SweepSpec::printUsage(argv[0]);
+            return 1;
+        }
+
+        return runSweep(spec);
+    }
+
     std::cout << std::fixed; // write floating-point values in fixed-point notation
 
     print_begin();
     print_line("Asymptotical Regularization in Computer Tomographie");
     print_line("Example: Schlieren Imaging");
-    print_line_begin("Optimisation:");
 #ifdef _OPENMP
-    print("OpenMP,");
+    print_line(ts("Optimisation: OpenMP, ") + Eigen::SimdInstructionSetsInUse());
+#else
+    print_line(ts("Optimisation: ") + Eigen::SimdInstructionSetsInUse());
 #endif
-    print_line_end(Eigen::SimdInstructionSetsInUse());
     print_end();
 /* -------------------------------------------------------------------- */
     print_begin();
-    print_line_begin(ts("Importing data from file: \"") + DATA_FILE);
-
-    MatrixXd zMat(ASYMREG_DATSRC_SIZE, ASYMREG_DATSRC_SIZE);
-    std::fstream fs;
-    fs.open(DATA_FILE, std::fstream::in);
-    if (fs.is_open()) {
-        fs >> zMat.format2(EIGEN_IOFMT_CSV);
-        print_line_end("\" ok!");
-    } else {
-        zMat.setZero();
-        print_line_end("\" failed!");
+
+    AsymRegEngine engine;
+    ReconstructionConfig config; // default geometry
+
+    MatrixXd zMat;
+    auto zFile = std::make_shared<MappedMatrixFile>(); // *.armx data is mapped and used in place
+    bool imported = false;
+    try {
+        imported = import_matrix_file(DATA_FILE, *zFile, zMat, EIGEN_IOFMT_CSV, verifyData); // size is taken from file
+    } catch (const IOFormatException &e) {
+        Logger::log(Logger::Error, "import", e.what(), {{"file", DATA_FILE}});
+    }
+
+    if (!imported) {
+        zMat.setZero(config.sourceSize, config.sourceSize);
+        Logger::log(Logger::Error, "import", ts("Importing data from file: \"") + DATA_FILE + "\" failed!",
+                    {{"file", DATA_FILE}});
+    }
+
+    const Map<const MatrixXd> zData = zFile->isOpen() ? zFile->map<MatrixXd>()
+                                                      : Map<const MatrixXd>(zMat.data(), zMat.rows(), zMat.cols());
+    if (imported) {
+        config.sourceSize = zData.rows();
+        print_line(ts("Importing data from file: \"") + DATA_FILE + "\" ok!");
     }
 
-    std::cout << "source data =" << std::endl
-              << zMat << std::endl << std::endl;
+    /* bulk output, only on request: */
+    if (Logger::isEnabled(Logger::Debug)) {
+        std::ostringstream os;
+        os << "source data =" << std::endl << zData;
+        Logger::log(Logger::Debug, "source", os.str());
+    }
     print_end();
 
-    AsymReg::createSourceFunction(zMat);
+    if (zFile->isOpen())
+        engine.createSourceFunction(zData, zFile); // shares the mapping
+    else
+        engine.createSourceFunction(zData);
 /* -------------------------------------------------------------------- */
-    print_begin();
-    print_line("Generating Schlieren Data Sets...");
+    /* measured projections are read by another thread, the regularization
+     * starts with the first one and folds in the others while they arrive.
+     * The reader thread shares the stream, a reader blocked in stdin may
+     * outlive main(): */
+    auto stream = std::make_shared<DataSetStream>(config.recordingAngles, config.numSamples());
+    std::thread reader;
+    Checkpoint checkpoint;
+    if (!resumeFile.empty()) {
+        print_begin();
+        print_line(ts("Resuming from Checkpoint: \"") + resumeFile + "\"");
 
-    Duration dt;
-    AsymReg::generateDataSet(0, AR_DELTA, &dt);
+        std::string error;
+        if (!readCheckpoint(resumeFile, &checkpoint, &error)) {
+            Logger::log(Logger::Error, "resume", error, {{"file", resumeFile}});
+            return 1;
+        }
 
-    print_line_begin("...done (time used: ");
-    std::cout << dt.value() << dt.unit() << ").";
-    print_line_end();
-    print_end();
+        print_end();
+    } else if (!streamFile.empty()) {
+        print_begin();
+        print_line(ts("Streaming Schlieren Data Sets from: \"") + streamFile + "\"");
+        print_end();
+
+        reader = std::thread([stream, streamFile]() {
+            if (streamFile == "-")
+                stream->read(std::cin); // pipe, ends with EOF
+            else if (stream->follow(streamFile) < 0)
+                Logger::log(Logger::Error, "stream", "Cannot open \"" + streamFile + "\"!");
+            stream->close();
+        });
+        engine.setDataSetStream(stream.get());
+    } else {
+        print_begin();
+        print_line("Generating Schlieren Data Sets...");
+
+        Duration dt;
+        engine.generateDataSet(config, AR_DELTA, &dt); // logs time used
+
+        print_end();
+    }
 /* -------------------------------------------------------------------- */
     print_begin();
     print_line("Running Asymptotical Regularization...");
@@ -75,18 +163,34 @@ int main(int argc, char **argv)
     ContourPlotterSettings sett;
     sett.setTitle("Regularisierte Loesung Xdot", 1);
 
+    if (!checkpointFile.empty())
+        engine.setCheckpointFile(checkpointFile); // after each iteration
+
     Duration dt2;
-    double err = AsymReg::regularize(0, AR_DELTA, AsymReg::RungeKutta, 0, 0., nullptr /*&sett*/, &dt2);
+    double err;
+    if (!resumeFile.empty()) {
+        err = engine.resume(checkpoint, nullptr /*&sett*/, &dt2); // with the settings of the checkpoint
+    } else {
+        err = engine.regularize(config, AR_DELTA, AsymRegEngine::RungeKutta, 0, 0., nullptr /*&sett*/, &dt2,
+                                AsymRegEngine::SystemMatrixProjector); // logs errors & time used
+    }
+
+    print_line(ts("Final error: ") + std::to_string(err));
 
-    auto &Xdot = AsymReg::result();
+    auto &Xdot = engine.result();
     //std::cout << "Xdot =" << std::endl
     //          << Xdot << std::endl << std::endl;
 
-    print_line_begin("...done (time used: ");
-    std::cout << dt2.value() << dt2.unit() << ").";
-    print_line_end();
     print_end();
 
+    if (reader.joinable()) {
+        stream->close(); // stops following the file, stdin is not read any further
+        if (streamFile == "-")
+            reader.detach(); // may still block in reading stdin, keeps its stream alive
+        else
+            reader.join();
+    }
+
     ContourPlotter plotter(&sett, Plotter::Output_Display_Widget);
     plotter.setData(Xdot);
     plotter.plot();
@@ -94,42 +198,81 @@ int main(int argc, char **argv)
 /* -------------------------------------------------------------------- */
 
     Plotter::closeAllRemainingPlotter();
+    Logger::closeJsonSink();
 
     return 0;
 }
 
-void print(const std::string &text)
+/**
+ * @brief Handles "--log-level LEVEL", "--log-json FILE", "--stream FILE",
+ * "--checkpoint FILE", "--resume FILE" and "--profile" and removes them from
+ * @a argv, so the remaining arguments can be parsed as sweep. The stream file
+ * is "-" for stdin.
+ */
+bool parse_options(int *argc, char **argv, std::string *streamFile,
+                   std::string *checkpointFile, std::string *resumeFile,
+                   bool *verifyData)
 {
-    if (!text.empty())
-        std::cout << " " << text;
+    int n = 1;
+    for (int i = 1; i < *argc; ++i) {
+        std::string opt = argv[i];
+        if (opt == "--profile") { // time breakdown at the end of each run
+            Profiler::setEnabled(true);
+            continue;
+        }
+        if (opt == "--verify") { // reads all *.armx source data on load
+            *verifyData = true;
+            continue;
+        }
+
+        if ((opt != "--log-level") && (opt != "--log-json") && (opt != "--stream")
+                && (opt != "--checkpoint") && (opt != "--resume")) {
+            argv[n++] = argv[i];
+            continue;
+        }
+
+        if (++i >= *argc) {
+            std::cerr << "missing value for option " << opt << std::endl;
+            return false;
+        }
+
+        if (opt == "--log-level") {
+            Logger::Level level;
+            if (!Logger::parseLevel(argv[i], &level)) {
+                std::cerr << "unknown log level \"" << argv[i]
+                          << "\" (use error, warning, info, verbose or debug)" << std::endl;
+                return false;
+            }
+            Logger::setLevel(level);
+        } else if (opt == "--stream") {
+            *streamFile = argv[i];
+        } else if (opt == "--checkpoint") {
+            *checkpointFile = argv[i];
+        } else if (opt == "--resume") {
+            *resumeFile = argv[i];
+        } else if (!Logger::openJsonSink(argv[i])) {
+            std::cerr << "cannot open log file \"" << argv[i] << "\"" << std::endl;
+            return false;
+        }
+    }
+
+    *argc = n;
+    return true;
 }
 
 void print_begin()
 {
-    std::cout << "****" << std::endl;
+    Logger::log(Logger::Verbose, "banner", "****");
 }
 
 void print_end()
 {
-    std::cout << "****" << std::endl << std::endl;
+    Logger::log(Logger::Verbose, "banner", "****\n");
 }
 
 void print_line(const std::string &text)
 {
-    print_line_begin(text);
-    print_line_end();
-}
-
-void print_line_begin(const std::string &text)
-{
-    std::cout << "** " << text;
-}
-
-void print_line_end(const std::string &text)
-{
-    if (!text.empty())
-        std::cout << " " << text;
-    std::cout << std::endl;
+    Logger::log(Logger::Verbose, "banner", "** " + text);
 }
 
 void set_fpu (unsigned int mode)
@@ -4,11 +4,13 @@
 #include <QtCore/QDir>
 #include <QtCore/QFileSystemWatcher>
 #include <QtCore/QSettings>
+#include <QtCore/QThread>
 #include <QtCore/QVariant>
 #include <QtCore/QVariantMap>
 
 #include <QtGui/QAction>
 #include <QtGui/QActionGroup>
+#include <QtGui/QCheckBox>
 #include <QtGui/QCloseEvent>
 #include <QtGui/QComboBox>
 #include <QtGui/QDoubleSpinBox>
@@ -35,11 +37,12 @@
 #include <qjson/serializer.h>
 
 #include <iostream>
-#include <fstream>
 
 #include "3rdparty/kiconutils.h"
 
 #include "asymreg.h"
+#include "asymregworker.h"
+#include "checkpoint.h"
 #include "constants.h"
 #include "datasourcetablewidget.h"
 #include "duration.h"
@@ -55,6 +58,8 @@
 
 #define MW_PLTCFG_FILE  "../data/plotconfig.json"
 
+#define MW_CHECKPOINT_FILE  "checkpoint.arcp" // in working directory
+
 // private variables:
 static Eigen::MatrixXd zMat; // TODO: move to MainWindow or AsymReg class
 
@@ -105,7 +110,9 @@ public:
 
 // class implementation:
 MainWindow::MainWindow()
-    : m_plotConfigChaned(false),
+    : m_engine(new AsymRegEngine),
+      m_asymRegRunning(false),
+      m_plotConfigChaned(false),
       m_plotTime(QDateTime::currentDateTime()),
       m_dataSourceChanged(false),
       m_dataSourceSet(false)
@@ -171,14 +178,32 @@ MainWindow::MainWindow()
     m_autoRunAction->setIcon(QIcon::fromTheme("media-seek-forward"));
     m_autoRunAction->setCheckable(true); // state will be set in readSettings(), default "false"
 
+    m_checkpointAction = new QAction(this);
+    m_checkpointAction->setText(tr("Checkpoints"));
+    m_checkpointAction->setToolTip(tr("Writes a checkpoint after each iteration of the regularization "
+                                      "to \"%1\" in the working directory.<br/>"
+                                      "A canceled run can be resumed from it.").arg(MW_CHECKPOINT_FILE));
+    m_checkpointAction->setIcon(QIcon::fromTheme("document-save"));
+    m_checkpointAction->setCheckable(true); // state will be set in readSettings(), default "false"
+
+    m_resumeAction = new QAction(this);
+    m_resumeAction->setText(tr("Resume"));
+    m_resumeAction->setToolTip(tr("Continues a regularization from a checkpoint file."));
+    m_resumeAction->setIcon(QIcon::fromTheme("document-open"));
+    connect(m_resumeAction, SIGNAL(triggered()),
+            this, SLOT(resumeAsymReg()));
+
     QToolBar *toolBar = new QToolBar;
     toolBar->addAction(quitAction);
     QAction *autoPlotAction = toolBar->addWidget(m_autoPlotToolButton);
     toolBar->addAction(m_closeAllPlotsAction);
     toolBar->addAction(m_autoRunAction);
+    toolBar->addAction(m_checkpointAction);
+    toolBar->addAction(m_resumeAction);
     toolBar->setToolButtonStyle(Qt::ToolButtonTextBesideIcon);
     toolBar->insertSeparator(autoPlotAction);  // separator between quit and autoplot
     toolBar->insertSeparator(m_autoRunAction); // separator between close-all-plots and autorun
+    toolBar->insertSeparator(m_checkpointAction); // separator between autorun and checkpoints
     toolBar->setMovable(false);
     toolBar->setObjectName("mainToolBar"); // shutdown warning from QSettings
     toolBar->setWindowTitle(tr("Toolbar")); // name shown in popup menu
@@ -209,11 +234,9 @@ MainWindow::MainWindow()
     systemLabel->setFont(runDescriptionFont);
     runConfigLayoutLeft->setWidget(0, QFormLayout::SpanningRole, systemLabel);
 
-    m_runGridSizeSpinBox = new QSpinBox;
+    m_runGridSizeSpinBox = new QSpinBox; // value is set in readSettings()
     m_runGridSizeSpinBox->setSingleStep(10);
-    m_runGridSizeSpinBox->setMaximum(ASYMREG_GRID_SIZE);
-    m_runGridSizeSpinBox->setValue(ASYMREG_GRID_SIZE); // TODO: read value in readSettings()
-    m_runGridSizeSpinBox->setDisabled(true); // has no function yet
+    m_runGridSizeSpinBox->setRange(10, 2048);
     runConfigLayoutRight->addRow(tr("system grid size:"), m_runGridSizeSpinBox);
 
     m_runRecAngSpinBox = new QSpinBox; // value is set in readSettings()
@@ -246,11 +269,15 @@ MainWindow::MainWindow()
 
     m_runSolverSelectComboBox = new QComboBox;
     m_runSolverSelectComboBox->addItem(tr("Euler (direct)"),
-                                       QVariant::fromValue<unsigned int>(AsymReg::Euler));
+                                       QVariant::fromValue<unsigned int>(AsymRegEngine::Euler));
     m_runSolverSelectComboBox->addItem(tr("Midpoint (2nd order)"),
-                                       QVariant::fromValue<unsigned int>(AsymReg::Midpoint));
+                                       QVariant::fromValue<unsigned int>(AsymRegEngine::Midpoint));
     m_runSolverSelectComboBox->addItem(tr("Runge Kutta (4th order)"),
-                                       QVariant::fromValue<unsigned int>(AsymReg::RungeKutta));
+                                       QVariant::fromValue<unsigned int>(AsymRegEngine::RungeKutta));
+    m_runSolverSelectComboBox->addItem(tr("Bogacki-Shampine (adaptive)"),
+                                       QVariant::fromValue<unsigned int>(AsymRegEngine::BogackiShampine));
+    m_runSolverSelectComboBox->addItem(tr("Nesterov (accelerated)"),
+                                       QVariant::fromValue<unsigned int>(AsymRegEngine::Nesterov));
     runConfigLayoutRight->addRow(tr("Select Solver:"), m_runSolverSelectComboBox);
 
     m_runEulerIterationSpinBox = new QSpinBox; // value is set in readSettings()
@@ -258,6 +285,10 @@ MainWindow::MainWindow()
     m_runEulerIterationSpinBox->setSpecialValueText(tr("auto")); // show "auto" when set to 0
     runConfigLayoutRight->addRow(tr("Max. iterations:"), m_runEulerIterationSpinBox);
 
+    m_runMultilevelCheckBox = new QCheckBox(tr("coarse to fine")); // value is set in readSettings()
+    m_runMultilevelCheckBox->setToolTip(tr("Regularize on coarser grids first, their result is the initial value of the next grid."));
+    runConfigLayoutLeft->addRow(tr("Multilevel:"), m_runMultilevelCheckBox);
+
     QHBoxLayout *runConfigLayout = new QHBoxLayout; // H = horizontal to place them left & right
     runConfigLayout->addLayout(runConfigLayoutLeft);
     runConfigLayout->addLayout(runConfigLayoutRight);
@@ -392,10 +423,22 @@ MainWindow::MainWindow()
             middleArea, SLOT(setDisabled(bool)));
     connect(m_runAsymRegButton, SIGNAL(toggled(bool)), // disable runConfigGroupBox -"-
             runConfigGroupBox, SLOT(setDisabled(bool)));
-    connect(m_runAsymRegButton, SIGNAL(clicked(bool)), // trigger runAsymReg() function
+    connect(m_runAsymRegButton, SIGNAL(clicked(bool)), // trigger runAsymReg() function, or cancel it
             this, SLOT(runAsymReg()));
-    connect(m_runAsymRegButton, SIGNAL(clicked(bool)), // enable 'dataRegularizedPlotButton' once runAsymReg() has run
-            dataRegularizedPlotButton, SLOT(setEnabled(bool)));
+    connect(m_runAsymRegButton, SIGNAL(toggled(bool)), // enable 'dataRegularizedPlotButton' once runAsymReg() has finished
+            dataRegularizedPlotButton, SLOT(setDisabled(bool)));
+    connect(m_runAsymRegButton, SIGNAL(toggled(bool)), // disable resume while running
+            m_resumeAction, SLOT(setDisabled(bool)));
+
+    /* worker thread for asymreg, keeps the gui responsive: */
+    m_asymRegThread = new QThread(this);
+    m_asymRegWorker = new AsymRegWorker(m_engine);
+    m_asymRegWorker->moveToThread(m_asymRegThread);
+    connect(m_asymRegWorker, SIGNAL(progress(int,int,double)),
+            this, SLOT(asymRegProgress(int,int,double)));
+    connect(m_asymRegWorker, SIGNAL(finished(double)),
+            this, SLOT(asymRegFinished(double)));
+    m_asymRegThread->start();
 
     /* central widget with layout: */
     QVBoxLayout *layout = new QVBoxLayout;
@@ -441,11 +484,18 @@ MainWindow::MainWindow()
 
 MainWindow::~MainWindow()
 {
+    /* stop a running regularization & the worker thread: */
+    m_engine->requestCancel();
+    m_asymRegThread->quit();
+    m_asymRegThread->wait();
+
     /* delete class members: */
+    delete m_asymRegWorker;
     delete m_dataSourceSelectButton->menu(); // found by valgrind
     delete m_plotConfigSelectButton->menu(); //   ^^ delete our Menu-classes, as they have no parent
     delete m_pressureFunctionPlotSettings;   // found by valgrind
     delete m_plotWatcher;
+    delete m_engine;
 
     /* clean up plot files: */
     QDir dir(QDir::currentPath());
@@ -527,6 +577,7 @@ int MainWindow::askToSaveDataSource(const QString &fileName)
         else
             proposedFile = tr("%1/new_data.csv").arg(QDir("../data").canonicalPath());
         QString filter =  tr("CSV Files(*.csv)");
+                filter += ";;" + tr("Binary Matrix Files(*.armx)");
                 filter += ";;" + tr("All Files(*.*)");
         QString dfileName = QFileDialog::getSaveFileName(this,
                                                         dtitle,
@@ -714,6 +765,10 @@ void MainWindow::loadDataSourceToTableWidget()
 {
     m_dataSourceTableWidget->blockSignals(true); // do not trigger 'itemChanged'-Signal
 
+    /* imported data may have another size: */
+    m_dataSourceTableWidget->setRowCount(zMat.rows());
+    m_dataSourceTableWidget->setColumnCount(zMat.cols());
+
     for (int r = 0; r < zMat.rows(); ++r) {
         for (int c = 0; c < zMat.cols(); ++c) {
             QTableWidgetItem *item = m_dataSourceTableWidget->item(r, c);
@@ -750,11 +805,11 @@ void MainWindow::plotDataSource()
 {
     prepareAsymReg();
 
-    Q_ASSERT(AsymReg::sourceFunction() != nullptr);
+    Q_ASSERT(m_engine->sourceFunction() != nullptr);
     Q_ASSERT(m_pressureFunctionPlotSettings != nullptr);
 
     Duration dur;
-    auto Z = AsymReg::sourceFunctionPlotData(&dur);
+    auto Z = m_engine->sourceFunctionPlotData(m_runGridSizeSpinBox->value(), &dur);
 
     auto dt = dur.value();
     auto unit = dur.unit();
@@ -782,7 +837,7 @@ void MainWindow::plotRegularizedData()
 
     ContourPlotter plotter(m_pressureFunctionPlotSettings, displayOut ?
                                Plotter::Output_Display_Widget : Plotter::Output_SVG_Image);
-    plotter.setData(AsymReg::result());
+    plotter.setData(m_engine->result());
 
     if (displayOut)
         plotter.plot(true); // plot to X11 window & do not block thread
@@ -808,6 +863,7 @@ void MainWindow::readSettings()
             m_autoPlotDataSrcAction->setChecked(settings.value("autoPlotDataSrc", true).toBool());
             m_autoPlotDataRegAction->setChecked(settings.value("autoPlotDataReg", true).toBool());
             m_autoRunAction->setChecked(settings.value("autoRun", false).toBool());
+            m_checkpointAction->setChecked(settings.value("checkpoints", false).toBool());
         settings.endGroup(); // "Toolbar"
         settings.beginGroup("DataSource");
             // restore datasource file actions:
@@ -825,12 +881,13 @@ void MainWindow::readSettings()
             settings.endArray();
         settings.endGroup(); // "DataSource"
         settings.beginGroup("AlgoRuntimeConfig");
-            //m_runGridSizeSpinBox->setValue(settings.value("grid-size", ASYMREG_GRID_SIZE).toInt());
+            m_runGridSizeSpinBox->setValue(settings.value("grid-size", ASYMREG_GRID_SIZE).toInt());
             m_runRecAngSpinBox->setValue(settings.value("rec-angles", AR_NUM_REC_ANGL).toInt());
             m_runDeltaSpinBox->setValue(settings.value("delta", .02).toDouble());
             m_runSolverSelectComboBox->setCurrentIndex(settings.value("solver", 0).toInt());
             m_runEulerStepSpinBox->setValue(settings.value("euler-step", H).toDouble());
             m_runEulerIterationSpinBox->setValue(settings.value("euler-iter", T).toInt());
+            m_runMultilevelCheckBox->setChecked(settings.value("multilevel", false).toBool());
         settings.endGroup(); // "AlgoRuntimeConfig"
     settings.endGroup(); // "Main"
 
@@ -844,39 +901,133 @@ void MainWindow::readSettings()
 void MainWindow::prepareAsymReg()
 {
     if (!m_dataSourceSet) {
-        AsymReg::createSourceFunction(zMat);
+        m_engine->createSourceFunction(zMat);
         m_dataSourceSet = true;
     }
 }
 
+/**
+ * @brief Starts the regularization in the worker thread.
+ * If a regularization is already running, it is asked to stop after the
+ * current iteration instead (the run-button acts as cancel-button).
+ */
 void MainWindow::runAsymReg()
 {
+    if (m_asymRegRunning) {
+        m_engine->requestCancel();
+        m_runAsymRegButton->setChecked(true); // keep button pressed until worker has finished
+        m_runAsymRegButton->setEnabled(false);
+        statusBar()->showMessage(tr("Canceling Regularization..."));
+        return;
+    }
+
     prepareAsymReg();
 
     bool autoPlot = m_autoPlotToolButton->isChecked();
 
-    if (autoPlot && m_autoPlotDataSrcAction->isChecked())
+    if (autoPlot && m_autoPlotDataSrcAction->isChecked() && !m_resumeCheckpoint)
         plotDataSource();
 
-    AsymReg::generateDataSet(m_runRecAngSpinBox->value(), m_runDeltaSpinBox->value());
-
-    AsymReg::ODE_Solver solver = static_cast<AsymReg::ODE_Solver>(
+    AsymRegWorker::Job job;
+    job.config.gridSize = m_runGridSizeSpinBox->value();
+    job.config.recordingAngles = m_runRecAngSpinBox->value();
+    job.delta = m_runDeltaSpinBox->value();
+    job.solver = static_cast<AsymRegEngine::ODE_Solver>(
                 m_runSolverSelectComboBox->itemData(m_runSolverSelectComboBox->currentIndex())
                 .value<unsigned int>());
-    Duration dur;
-    double error = AsymReg::regularize(m_runRecAngSpinBox->value(),
-                                       m_runDeltaSpinBox->value(),
-                                       solver,
-                                       m_runEulerIterationSpinBox->value(),
-                                       m_runEulerStepSpinBox->value(),
-                                       nullptr,//m_pressureFunctionPlotSettings,
-                                       &dur);
+    job.iterations = m_runEulerIterationSpinBox->value();
+    job.step = m_runEulerStepSpinBox->value();
+    job.multilevel = m_runMultilevelCheckBox->isChecked();
+    if (m_checkpointAction->isChecked())
+        job.checkpointFile = MW_CHECKPOINT_FILE;
+    job.resume.swap(m_resumeCheckpoint); // set by resumeAsymReg()
+
+    m_engine->resetCancel();
+    m_asymRegWorker->setJob(job);
+    m_asymRegRunning = true;
+
+    m_runAsymRegButton->setChecked(true); // also needed if called by auto run
+    m_runAsymRegButton->setText(tr("&Cancel Asymptotical Regularization"));
+    m_runAsymRegButton->setIcon(QIcon::fromTheme("process-stop"));
+    statusBar()->showMessage(job.resume ? tr("Resuming Regularization...") : tr("Generating Data Sets..."));
+
+    QMetaObject::invokeMethod(m_asymRegWorker, "run", Qt::QueuedConnection);
+}
 
-    auto dt = dur.value();
-    auto unit = dur.unit();
-    statusBar()->showMessage(tr("Regularization Time: %L1%2").arg(dt, 0, 'f', 3).arg(unit));
+/**
+ * @brief Continues a regularization from a checkpoint file.
+ * The run configuration shows the settings of the checkpoint, the data sets
+ * are taken from the checkpoint as well.
+ */
+void MainWindow::resumeAsymReg()
+{
+    if (m_asymRegRunning)
+        return;
+
+    QString title = tr("Resume Regularization - %1").arg(qApp->applicationName());
+    QString filter = tr("Checkpoint Files(*.arcp)");
+    QString fileName = QFileDialog::getOpenFileName(this,
+                                                    title,
+                                                    QDir::currentPath(),
+                                                    filter);
+    if (fileName.isEmpty())
+        return;
+
+    auto cp = std::make_shared<Checkpoint>();
+    std::string error;
+    if (!readCheckpoint(fileName.toStdString(), cp.get(), &error)) {
+        QMessageBox::warning(this, title, QString::fromStdString(error));
+        return;
+    }
+
+    m_runGridSizeSpinBox->setValue(cp->config.gridSize);
+    m_runRecAngSpinBox->setValue(cp->config.recordingAngles);
+    m_runDeltaSpinBox->setValue(cp->delta);
+    m_runSolverSelectComboBox->setCurrentIndex(
+                m_runSolverSelectComboBox->findData(QVariant::fromValue<unsigned int>(cp->solver)));
+    m_runEulerIterationSpinBox->setValue(cp->iterations);
+    if (cp->step > 0.)
+        m_runEulerStepSpinBox->setValue(cp->step);
+    m_runMultilevelCheckBox->setChecked(false); // the checkpoint is of the target grid
+
+    m_resumeCheckpoint = cp;
+    runAsymReg();
+}
+
+void MainWindow::asymRegProgress(int level, int iteration, double error)
+{
+    const int levels = (level == 0) ? 0
+                     : int(AsymRegEngine::multilevelGrids(m_runGridSizeSpinBox->value()).size());
+
+    int max = m_runEulerIterationSpinBox->value();
+    if ((max == 0) || (level < levels)) // discrepancy principle is used
+        max = T;
 
-    if (autoPlot && m_autoPlotDataRegAction->isChecked()) {
+    QString message = tr("Iteration %1 / %2 with error = %L3")
+                      .arg(iteration).arg(max).arg(error, 0, 'f', 6);
+    if (level > 0) // iterations restart on every level of regularizeMultilevel()
+        message = tr("Level %1 / %2: %3").arg(level).arg(levels).arg(message);
+
+    statusBar()->showMessage(message);
+}
+
+void MainWindow::asymRegFinished(double error)
+{
+    m_asymRegRunning = false;
+
+    bool canceled = m_engine->isCancelRequested();
+    if (canceled) {
+        statusBar()->showMessage(tr("Regularization canceled."));
+    } else {
+        const Duration &dur = m_asymRegWorker->duration();
+        auto dt = dur.value();
+        auto unit = dur.unit();
+        statusBar()->showMessage(tr("Regularization Time: %L1%2").arg(dt, 0, 'f', 3).arg(unit));
+    }
+
+    bool autoPlot = m_autoPlotToolButton->isChecked();
+
+    if (!canceled && autoPlot && m_autoPlotDataRegAction->isChecked()) {
         QString t2, t3, t4;
         t2 = "regularized";
         t3 = "[" + m_runSolverSelectComboBox->currentText() + ": "
@@ -894,7 +1045,7 @@ void MainWindow::runAsymReg()
         bool displayOut = (m_runGridSizeSpinBox->value() > 300);
         ContourPlotter plotter(&sett, displayOut ?
                                    Plotter::Output_Display_Widget : Plotter::Output_SVG_Image);
-        plotter.setData(AsymReg::result());
+        plotter.setData(m_engine->result());
 
         if (displayOut)
             plotter.plot(true); // plot to X11 window & do not block thread
@@ -905,6 +1056,9 @@ void MainWindow::runAsymReg()
         m_closeAllPlotsAction->setEnabled(true);
     }
 
+    m_runAsymRegButton->setText(tr("&Run Asymptotical Regularization"));
+    m_runAsymRegButton->setIcon(QIcon::fromTheme("media-playback-start"));
+    m_runAsymRegButton->setEnabled(true);
     m_runAsymRegButton->setChecked(false); // raise button so it can be pressed again
                                            // will also automatically enable widgets
 }
@@ -929,11 +1083,10 @@ void MainWindow::saveDataSource()
 
 void MainWindow::saveDataSource(const QString &fileName, bool reload)
 {
-    std::fstream fs;
-    fs.open(fileName.toAscii().data(), std::fstream::out | std::fstream::trunc);
-    Q_ASSERT(fs.is_open());
-    fs << zMat.format(EIGEN_IOFMT_CSV);
-    fs.close();
+    // "*.armx" is written as binary container, everything else as csv:
+    bool saved = export_matrix_file(fileName.toAscii().data(), zMat, EIGEN_IOFMT_CSV);
+    Q_ASSERT(saved);
+    Q_UNUSED(saved);
 
     discardDataSource();
     if (reload) {
@@ -973,6 +1126,7 @@ void MainWindow::saveSettings() const
             settings.setValue("autoPlotDataSrc", m_autoPlotDataSrcAction->isChecked());
             settings.setValue("autoPlotDataReg", m_autoPlotDataRegAction->isChecked());
             settings.setValue("autoRun", m_autoRunAction->isChecked());
+            settings.setValue("checkpoints", m_checkpointAction->isChecked());
         settings.endGroup(); // "Toolbar"
         settings.beginGroup("DataSource");
             // save datasource file actions:
@@ -990,12 +1144,13 @@ void MainWindow::saveSettings() const
             settings.endArray();
         settings.endGroup(); // "DataSource"
         settings.beginGroup("AlgoRuntimeConfig");
-            //settings.setValue("grid-size", m_runGridSizeSpinBox->value());
+            settings.setValue("grid-size", m_runGridSizeSpinBox->value());
             settings.setValue("rec-angles", m_runRecAngSpinBox->value());
             settings.setValue("delta", m_runDeltaSpinBox->value());
             settings.setValue("solver", m_runSolverSelectComboBox->currentIndex());
             settings.setValue("euler-step", m_runEulerStepSpinBox->value());
             settings.setValue("euler-iter", m_runEulerIterationSpinBox->value());
+            settings.setValue("multilevel", m_runMultilevelCheckBox->isChecked());
         settings.endGroup(); // "AlgoRuntimeConfig"
     settings.endGroup(); // "Main"
 }
@@ -1030,6 +1185,7 @@ void MainWindow::selectDataSource(QAction *action)
         QString title = tr("Load File - %1").arg(qApp->applicationName());
         QString proposedFile = QDir("../data").canonicalPath();
         QString filter =  tr("CSV Files(*.csv)");
+                filter += ";;" + tr("Binary Matrix Files(*.armx)");
                 filter += ";;" + tr("All Files(*.*)");
         fileName = QFileDialog::getOpenFileName(this,
                                                 title,
@@ -1060,12 +1216,10 @@ void MainWindow::selectDataSource(QAction *action)
     // try to import data to zMat:
     if (!fileName.isEmpty()) {
         QString exceptionString;
-        std::fstream fs;
+        bool imported = false;
         try {
-            fs.open(fileName.toAscii().data(), std::fstream::in);
-            fs.exceptions(std::ios_base::failbit | std::ios_base::badbit); // throw execptions on bad and fail
-            fs >> zMat.format2(EIGEN_IOFMT_CSV);
-            fs.close();
+            // size of zMat is taken from file:
+            imported = import_matrix_file(fileName.toAscii().data(), zMat, EIGEN_IOFMT_CSV);
         } catch (const std::ios_base::failure &e) {
             exceptionString = tr("Caught an ios_base::failure.\n"
                              "Explanatory string: %1\n")
@@ -1078,7 +1232,7 @@ void MainWindow::selectDataSource(QAction *action)
 
         // did something fail?
         // (Exceptions are only for debugging)
-        if (fs.fail() || !exceptionString.isEmpty()) {
+        if (!imported || !exceptionString.isEmpty()) {
             // prepare information:
             QFileInfo fileInfo(fileName);
             QString title = tr("Import Data Source - %1").arg(qApp->applicationName());
@@ -7,17 +7,24 @@
 #include <QtCore/QPointer>
 #include <QtCore/QStack>
 
+#include <memory>
+
+class AsymRegEngine;
+class AsymRegWorker;
 class DataSourceTableWidget;
 class PlotterSettings;
 class QActionGroup;
+class QCheckBox;
 class QComboBox;
 class QDoubleSpinBox;
 class QFileSystemWatcher;
 class QPushButton;
 class QSpinBox;
+class QThread;
 class QTableWidgetItem;
 class QToolButton;
 class SvgViewer;
+struct Checkpoint;
 
 class MainWindow : public QMainWindow
 {
@@ -47,6 +54,9 @@ private slots:
     void plotRegularizedData();
     void prepareAsymReg();
     void runAsymReg();
+    void resumeAsymReg();
+    void asymRegProgress(int level, int iteration, double error);
+    void asymRegFinished(double error);
 
     // private slots for viewing plots:
     void closeAllPlots();
@@ -79,6 +89,11 @@ private:
     void saveSettings() const;
 
     // members for run configuration:
+    AsymRegEngine *m_engine;
+    AsymRegWorker *m_asymRegWorker;
+    QThread *m_asymRegThread;
+    bool m_asymRegRunning;
+    QCheckBox *m_runMultilevelCheckBox;
     QComboBox *m_runSolverSelectComboBox;
     QDoubleSpinBox *m_runDeltaSpinBox;
     QDoubleSpinBox *m_runEulerStepSpinBox;
@@ -86,6 +101,7 @@ private:
     QSpinBox *m_runEulerIterationSpinBox;
     QSpinBox *m_runGridSizeSpinBox;
     QSpinBox *m_runRecAngSpinBox;
+    std::shared_ptr<const Checkpoint> m_resumeCheckpoint; // taken by the next runAsymReg()
 
     // members for plotter configuration handling:
     PlotterSettings *m_pressureFunctionPlotSettings;
@@ -113,6 +129,8 @@ private:
 
     // other:
     QAction *m_autoRunAction;
+    QAction *m_checkpointAction;
+    QAction *m_resumeAction;
 };
 
 #endif // MAINWINDOW_H_
@@ -1,66 +1,229 @@
 #ifndef ODE_H_
 #define ODE_H_
 
+#ifdef _OPENMP
+#  include <omp.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+
+#include "profiler.h"
+
+/*
+ * All solvers below evaluate the recording angles in parallel. Every thread
+ * works on its own stage buffers and stores the increment of angle i in dXdt[i]
+ * (the derivatives passed in are overwritten). The increments are then summed
+ * up by treeReduce(), whose order of additions does not depend on the number
+ * of threads. So the result is bit-identical for any OpenMP configuration.
+ *
+ * The stage buffers are passed in by the caller (one Stages object per thread),
+ * so a solver step does not allocate memory once all buffers are sized.
+ * The reduction and the update of X are profiled as Profiler::OdeCombine.
+ */
 namespace ODE {
 
+/**
+ * @brief Stage buffers used by one thread.
+ */
+template <typename Derived>
+struct Stages {
+    Derived Xs; /**< argument of derivs() */
+    Derived K2;
+    Derived K3;
+};
+
+inline int threadNum()
+{
+#ifdef _OPENMP
+    return omp_get_thread_num();
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief Sums up @a count matrices in @a A by pairwise tree reduction.
+ * The sum is stored in A[0], all other matrices are overwritten.
+ * Every column is reduced independently, so the threads share the work
+ * column-wise while each column is always added up in the same order.
+ */
+template <typename Derived>
+void treeReduce(const int count, Derived *A)
+{
+    typedef typename Derived::Index Index;
+
+    #pragma omp parallel for schedule(static)
+    for (Index c = 0; c < A[0].cols(); ++c) {
+        for (int stride = 1; stride < count; stride *= 2) {
+            for (int i = 0; i + stride < count; i += 2 * stride)
+                A[i].col(c) += A[i + stride].col(c);
+        }
+    }
+}
+
+/**
+ * @brief Single precision version of treeReduce().
+ * Every column is summed up in double precision, in the order of the
+ * matrices, and rounded once. The sums are kept in blocks on the stack.
+ */
+inline void treeReduce(const int count, Matrix<float, Dynamic, Dynamic> *A)
+{
+    typedef MatrixXf::Index Index;
+    typedef Matrix<double, Dynamic, 1, 0, 256, 1> BlockSum;
+
+    #pragma omp parallel for schedule(static)
+    for (Index c = 0; c < A[0].cols(); ++c) {
+        for (Index r = 0; r < A[0].rows(); r += 256) {
+            const Index n = std::min<Index>(256, A[0].rows() - r);
+            BlockSum Sum = A[0].col(c).segment(r, n).cast<double>();
+            for (int i = 1; i < count; ++i)
+                Sum += A[i].col(c).segment(r, n).cast<double>();
+            A[0].col(c).segment(r, n) = Sum.cast<float>();
+        }
+    }
+}
+
 // Euler (direct)
 template <typename Derived, typename DerivsFunc>
-void euler(const int angles, const EigenBase<Derived> &X, const Derived *dXdt,
+void euler(const int angles, const EigenBase<Derived> &X, Derived *dXdt,
            const typename Derived::Scalar h,
-           EigenBase<Derived> &Xout, DerivsFunc &derivs)
+           EigenBase<Derived> &Xout, DerivsFunc & /*derivs*/, Stages<Derived> * /*stages*/)
 {
     typedef typename Derived::Scalar Scalar;
-    typedef typename Derived::Index Index;
 
-    Xout.derived() = X;
-
-    #pragma omp parallel for
-    for (Index i = 0; i < angles; ++i)
-        Xout.derived() += (h / Scalar(angles)) * dXdt[i];
+    Profiler::Scope scope(Profiler::OdeCombine, angles * X.size());
+    treeReduce(angles, dXdt);
+    Xout.derived() = X.derived() + (h / Scalar(angles)) * dXdt[0];
 }
 
 // Runge-Kutta 2th order
 template <typename Derived, typename DerivsFunc>
-void rk2(const int angles, const EigenBase<Derived> &X, const Derived *dXdt,
+void rk2(const int angles, const EigenBase<Derived> &X, Derived *dXdt,
            const typename Derived::Scalar h,
-           EigenBase<Derived> &Xout, DerivsFunc &derivs)
+           EigenBase<Derived> &Xout, DerivsFunc &derivs, Stages<Derived> *stages)
 {
     typedef typename Derived::Scalar Scalar;
-    typedef typename Derived::Index Index;
-
-    Xout.derived() = X;
 
-    Derived K1, K2;
+    #pragma omp parallel
+    {
+        Derived &Xs = stages[threadNum()].Xs; // stage buffers of this thread
+        Derived &K2 = stages[threadNum()].K2;
 
-    #pragma omp parallel for
-    for (int i = 0; i < angles; ++i) {
-        K1 = .5 * h * dXdt[i];
-        derivs(i, K1 + X.derived(), K2);
-        Xout.derived() += (h / Scalar(angles)) * K2;
+        #pragma omp for schedule(dynamic)
+        for (int i = 0; i < angles; ++i) {
+            Xs = Scalar(.5) * h * dXdt[i] + X.derived();
+            derivs(i, Xs, K2);
+            dXdt[i].swap(K2); // increment of angle i is K2
+        }
     }
+
+    Profiler::Scope scope(Profiler::OdeCombine, angles * X.size());
+    treeReduce(angles, dXdt);
+    Xout.derived() = X.derived() + (h / Scalar(angles)) * dXdt[0];
 }
 
 // Runge-Kutta 4th order
 template <typename Derived, typename DerivsFunc>
-void rk4(const int angles, const EigenBase<Derived> &X, const Derived *dXdt,
+void rk4(const int angles, const EigenBase<Derived> &X, Derived *dXdt,
            const typename Derived::Scalar h,
-           EigenBase<Derived> &Xout, DerivsFunc &derivs)
+           EigenBase<Derived> &Xout, DerivsFunc &derivs, Stages<Derived> *stages)
 {
     typedef typename Derived::Scalar Scalar;
 
-    Xout.derived() = X;
+    #pragma omp parallel
+    {
+        Derived &Xs = stages[threadNum()].Xs; // stage buffers of this thread
+        Derived &K2 = stages[threadNum()].K2;
+        Derived &K3 = stages[threadNum()].K3;
 
-    Derived K1, K2, K3, K4;
+        #pragma omp for schedule(dynamic)
+        for (int i = 0; i < angles; ++i) {
+            // K1 = dXdt[i]
+            Xs = Scalar(.5) * h * dXdt[i] + X.derived();
+            derivs(i, Xs, K2);
+            Xs = Scalar(.5) * h * K2 + X.derived();
+            derivs(i, Xs, K3);
+            K2 += K3;                                 // K2 + K3
+            Xs = h * K3 + X.derived();
+            derivs(i, Xs, K3);                        // K4
+            dXdt[i] = h/Scalar(6)*(dXdt[i] + K3) + h/Scalar(3)*K2; // increment of angle i
+        }
+    }
+
+    Profiler::Scope scope(Profiler::OdeCombine, angles * X.size());
+    treeReduce(angles, dXdt);
+    Xout.derived() = X.derived() + dXdt[0] / Scalar(angles);
+}
+
+// Bogacki-Shampine 3(2), embedded for step size control
+/**
+ * @brief One step of the Bogacki-Shampine method with error estimate.
+ * Like the solvers above every angle is integrated on its own and the
+ * increments are averaged. The difference of the 3rd and the embedded 2nd
+ * order solution of angle i is scaled elementwise by
+ * tol * (1 + max(|X|, |X_i|)) and its RMS norm is stored in @a errors[i].
+ * The mean of these norms (in angle order, so it does not depend on the number
+ * of threads) bounds the error of the averaged step and is returned; a step
+ * with a result <= 1 should be accepted, see nextStep(). @a dXdt is always
+ * overwritten, even if the step is rejected.
+ */
+template <typename Derived, typename DerivsFunc>
+double bs23(const int angles, const EigenBase<Derived> &X, Derived *dXdt,
+            const typename Derived::Scalar h,
+            EigenBase<Derived> &Xout, DerivsFunc &derivs, Stages<Derived> *stages,
+            const typename Derived::Scalar tol, double *errors)
+{
+    typedef typename Derived::Scalar Scalar;
 
-    #pragma omp parallel for
-    for (int i = 0; i < angles; ++i) {
-        K1 = dXdt[i];
-        derivs(i, .5 * h * K1 + X.derived(), K2);
-        derivs(i, .5 * h * K2 + X.derived(), K3);
-        derivs(i,      h * K3 + X.derived(), K4);
+    #pragma omp parallel
+    {
+        Derived &Xs = stages[threadNum()].Xs; // stage buffers of this thread
+        Derived &K2 = stages[threadNum()].K2;
+        Derived &K3 = stages[threadNum()].K3;
 
-        Xout.derived() += (h/6.*(K1 + K4) + h/3.*(K2 + K3)) / Scalar(angles);
+        #pragma omp for schedule(dynamic)
+        for (int i = 0; i < angles; ++i) {
+            // K1 = dXdt[i]
+            Xs = Scalar(.5) * h * dXdt[i] + X.derived();
+            derivs(i, Xs, K2);
+            Xs = Scalar(.75) * h * K2 + X.derived();
+            derivs(i, Xs, K3);
+            Xs = h*Scalar(2./9.)*dXdt[i] + h/Scalar(3)*K2 + h*Scalar(4./9.)*K3; // increment of angle i
+            K2 = h*Scalar(-5./72.)*dXdt[i] + h/Scalar(12)*K2 + h/Scalar(9)*K3;   // error without K4
+            dXdt[i].swap(Xs);
+            Xs = X.derived() + dXdt[i];                      // 3rd order solution
+            derivs(i, Xs, K3);                               // K4
+            K2 -= h/Scalar(8) * K3;                          // error estimate
+            errors[i] = std::sqrt(double((K2.array() / (tol * (Scalar(1) + X.derived().array().abs().max(Xs.array().abs()))))
+                                         .square().mean()));
+        }
     }
+
+    Profiler::Scope scope(Profiler::OdeCombine, angles * X.size());
+    double err = 0.;
+    for (int i = 0; i < angles; ++i)
+        err += errors[i];
+
+    treeReduce(angles, dXdt);
+    Xout.derived() = X.derived() + dXdt[0] / Scalar(angles);
+
+    return err / angles;
+}
+
+/**
+ * @brief Proposes the next step size from the step size @a h and the scaled
+ * error @a err, whose local error is O(h^order) (3 for bs23()).
+ * The step changes at most by a factor of 5 and at least 0.2.
+ */
+template <typename Scalar>
+inline Scalar nextStep(const Scalar h, const Scalar err, const int order)
+{
+    if (!(err > 0.)) // zero or NaN
+        return (err == 0.) ? 5. * h : .2 * h;
+
+    const Scalar factor = Scalar(.9) * std::pow(err, Scalar(-1.) / order);
+    return h * std::min(Scalar(5.), std::max(Scalar(.2), factor));
 }
 
 } // namespace ODE
@@ -0,0 +1,207 @@
+#include "profiler.h"
+
+#include <cstdio>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+#include "alloccounter.h"
+
+std::atomic<bool> Profiler::enabled(false);
+
+static const char *phaseNames[] = {
+    "interpolator",
+    "forward projection",
+    "backprojection",
+    "ode combine",
+    "error evaluation"
+};
+static_assert(sizeof(phaseNames) / sizeof(phaseNames[0]) == Profiler::PhaseCount,
+              "a name is needed for every phase");
+
+/**
+ * @brief Counters of one thread.
+ * Only the owning thread writes, so an update is a relaxed load and store
+ * (no locked instruction). totals() may read them at any time.
+ */
+struct Profiler::ThreadCounters
+{
+    ThreadCounters();
+    ~ThreadCounters();
+
+    static inline void add(std::atomic<unsigned long long> &counter, unsigned long long value)
+    { counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed); }
+
+    std::atomic<unsigned long long> calls[PhaseCount];
+    std::atomic<unsigned long long> samples[PhaseCount];
+    std::atomic<unsigned long long> nanoseconds[PhaseCount];
+    std::atomic<unsigned long long> allocations[PhaseCount];
+    std::atomic<unsigned long long> bytes[PhaseCount];
+};
+
+/* registry of all threads, counters of finished threads are kept in retired: */
+static std::mutex registryMutex;
+static std::vector<Profiler::ThreadCounters *> registry;
+static Profiler::Totals retired;
+
+// private functions:
+static Profiler::ThreadCounters *threadCounters();
+
+// function implementations:
+Profiler::ThreadCounters::ThreadCounters()
+{
+    for (int p = 0; p < PhaseCount; ++p) {
+        calls[p] = 0;
+        samples[p] = 0;
+        nanoseconds[p] = 0;
+        allocations[p] = 0;
+        bytes[p] = 0;
+    }
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    registry.push_back(this);
+}
+
+Profiler::ThreadCounters::~ThreadCounters()
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (int p = 0; p < PhaseCount; ++p) {
+        retired.phase[p].calls += calls[p];
+        retired.phase[p].samples += samples[p];
+        retired.phase[p].nanoseconds += nanoseconds[p];
+        retired.phase[p].allocations += allocations[p];
+        retired.phase[p].bytes += bytes[p];
+    }
+    ++retired.threads;
+
+    for (auto it = registry.begin(); it != registry.end(); ++it) {
+        if (*it == this) {
+            registry.erase(it);
+            break;
+        }
+    }
+}
+
+Profiler::ThreadCounters *threadCounters()
+{
+    static thread_local Profiler::ThreadCounters counters; // registered on first use
+    return &counters;
+}
+
+Profiler::Totals::Totals()
+    : phase(),
+      threads(0)
+{}
+
+Profiler::Totals Profiler::Totals::operator-(const Totals &other) const
+{
+    Totals diff;
+    for (int p = 0; p < PhaseCount; ++p) {
+        diff.phase[p].calls = phase[p].calls - other.phase[p].calls;
+        diff.phase[p].samples = phase[p].samples - other.phase[p].samples;
+        diff.phase[p].nanoseconds = phase[p].nanoseconds - other.phase[p].nanoseconds;
+        diff.phase[p].allocations = phase[p].allocations - other.phase[p].allocations;
+        diff.phase[p].bytes = phase[p].bytes - other.phase[p].bytes;
+    }
+    diff.threads = threads; // not a counter
+    return diff;
+}
+
+void Profiler::setEnabled(bool on)
+{
+    enabled = on;
+}
+
+const char *Profiler::phaseName(Phase phase)
+{
+    return phaseNames[phase];
+}
+
+/**
+ * @brief Sums up the counters of all threads, including finished ones.
+ */
+Profiler::Totals Profiler::totals()
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+
+    Totals sum = retired;
+    for (const ThreadCounters *tc : registry) {
+        for (int p = 0; p < PhaseCount; ++p) {
+            sum.phase[p].calls += tc->calls[p].load(std::memory_order_relaxed);
+            sum.phase[p].samples += tc->samples[p].load(std::memory_order_relaxed);
+            sum.phase[p].nanoseconds += tc->nanoseconds[p].load(std::memory_order_relaxed);
+            sum.phase[p].allocations += tc->allocations[p].load(std::memory_order_relaxed);
+            sum.phase[p].bytes += tc->bytes[p].load(std::memory_order_relaxed);
+        }
+    }
+    sum.threads += registry.size();
+
+    return sum;
+}
+
+/**
+ * @brief Formats @a totals as table, one line per phase with at least one call.
+ * The share of each phase refers to the summed time of all phases.
+ * @param wallSeconds Wall time of the profiled run, printed below the table.
+ */
+std::string Profiler::report(const Totals &totals, double wallSeconds)
+{
+    double sum = 0.;
+    for (int p = 0; p < PhaseCount; ++p)
+        sum += totals.phase[p].nanoseconds * 1e-9;
+
+    std::ostringstream os;
+    char line[160];
+    std::snprintf(line, sizeof(line), "%-20s %10s %12s %11s %11s %7s %10s %12s",
+                  "phase", "calls", "samples", "time [s]", "call [us]", "share", "allocs", "bytes");
+    os << line;
+
+    for (int p = 0; p < PhaseCount; ++p) {
+        const Counters &c = totals.phase[p];
+        if (c.calls == 0)
+            continue;
+
+        const double seconds = c.nanoseconds * 1e-9;
+        std::snprintf(line, sizeof(line), "%-20s %10llu %12llu %11.4f %11.2f %6.1f%% %10llu %12llu",
+                      phaseNames[p], c.calls, c.samples, seconds, c.nanoseconds * 1e-3 / c.calls,
+                      (sum > 0.) ? 100. * seconds / sum : 0., c.allocations, c.bytes);
+        os << std::endl << line;
+    }
+
+    std::snprintf(line, sizeof(line), "%-20s %10s %12s %11.4f (summed over %d threads, wall time %.4f s)",
+                  "total", "", "", sum, totals.threads, wallSeconds);
+    os << std::endl << line;
+
+    return os.str();
+}
+
+void Profiler::Scope::start(Phase phase, unsigned long long samples)
+{
+    m_thread = threadCounters();
+    m_phase = phase;
+    m_samples = samples;
+    m_allocations = AllocationCounter::threadAllocations();
+    m_bytes = AllocationCounter::threadBytes();
+    m_start = std::chrono::steady_clock::now();
+}
+
+/**
+ * @brief Ends the scope before its destruction, further calls do nothing.
+ */
+void Profiler::Scope::stop()
+{
+    if (m_thread == nullptr)
+        return;
+
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                  std::chrono::steady_clock::now() - m_start).count();
+
+    ThreadCounters::add(m_thread->calls[m_phase], 1);
+    ThreadCounters::add(m_thread->samples[m_phase], m_samples);
+    ThreadCounters::add(m_thread->nanoseconds[m_phase], ns);
+    ThreadCounters::add(m_thread->allocations[m_phase],
+                        AllocationCounter::threadAllocations() - m_allocations);
+    ThreadCounters::add(m_thread->bytes[m_phase], AllocationCounter::threadBytes() - m_bytes);
+
+    m_thread = nullptr;
+}
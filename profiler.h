@@ -0,0 +1,106 @@
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+/**
+ * Process-wide profiler of the hot paths of AsymRegEngine.
+ * A Scope measures time, heap allocations (see AllocationCounter) and the
+ * number of processed samples of one phase. Every thread adds to its own
+ * counters, so scopes inside parallel loops do not contend; totals() sums up
+ * all threads. Time is summed over threads, a scope around a whole parallel
+ * region counts its wall time once.
+ * Profiling is switched at runtime by setEnabled(), a disabled Scope costs a
+ * single atomic load.
+ */
+namespace Profiler {
+
+enum Phase {
+    Interpolator,      /**< construction of BilinearInterpol on the grid */
+    ForwardProjection, /**< Radon transform of one angle */
+    Backprojection,    /**< adjoint of one angle, including the residual */
+    OdeCombine,        /**< reduction of the increments and update of X */
+    ErrorEvaluation,   /**< ||Y_delta - F(X)|| of one angle */
+    PhaseCount
+};
+
+struct Counters
+{
+    unsigned long long calls;
+    unsigned long long samples;
+    unsigned long long nanoseconds;
+    unsigned long long allocations;
+    unsigned long long bytes;
+};
+
+/**
+ * @brief Counters of all threads.
+ * The difference of two totals covers the work done in between, with engines
+ * running in parallel it includes their work as well.
+ */
+struct Totals
+{
+    Totals();
+
+    Totals operator-(const Totals &other) const;
+
+    Counters phase[PhaseCount];
+    int threads; /**< number of threads which have recorded anything so far */
+};
+
+extern std::atomic<bool> enabled;
+
+void setEnabled(bool on);
+
+inline bool isEnabled()
+{ return enabled.load(std::memory_order_relaxed); }
+
+const char *phaseName(Phase phase);
+
+Totals totals();
+
+std::string report(const Totals &totals, double wallSeconds);
+
+struct ThreadCounters;
+
+/**
+ * @brief Adds the time and the allocations from construction to destruction
+ * (or stop()) to @a phase of the calling thread.
+ */
+class Scope
+{
+public:
+    explicit Scope(Phase phase, unsigned long long samples = 0)
+        : m_thread(nullptr)
+    {
+        if (isEnabled())
+            start(phase, samples);
+    }
+
+    ~Scope()
+    {
+        if (m_thread != nullptr)
+            stop();
+    }
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+    void stop();
+
+private:
+    void start(Phase phase, unsigned long long samples);
+
+    ThreadCounters *m_thread;
+    Phase m_phase;
+    unsigned long long m_samples;
+    unsigned long long m_allocations;
+    unsigned long long m_bytes;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+} // namespace Profiler
+
+#endif // PROFILER_H_
@@ -0,0 +1,128 @@
+#ifndef RADONMATRIX_H_
+#define RADONMATRIX_H_
+
+#include "eigen.h"
+
+#include <Eigen/SparseCore>
+
+#include <vector>
+
+/**
+ * @brief Radon System Matrix
+ * The forward Radon Operator and its Backprojection assembled once as
+ * sparse matrices for a fixed geometry (recording angles, grid size and
+ * sample rate). The coefficients and the grid data are of type @a _Scalar,
+ * see RadonMatrix and RadonMatrixf.
+ * Each recording angle n owns the block of @a numSamples rows starting at
+ * n*numSamples. A column index is the linear (column-major) index of a grid
+ * point, so a grid matrix X can be used directly as vector.
+ *
+ * The forward matrix has the bilinear interpolation and the trapezoidal
+ * weights baked in, a projection is therefore a single sparse matrix-vector
+ * product. The Backprojection is pixel-driven, every grid point receives
+ * exactly one sample of an angle (or none). It is therefore stored as the
+ * sample index of every grid point, one column per angle, and applied as a
+ * plain gather.
+ */
+template <typename _Scalar>
+class BasicRadonMatrix
+{
+public:
+    typedef _Scalar Scalar;
+    typedef Matrix<Scalar, Dynamic, Dynamic> GridType;
+    typedef SparseMatrix<Scalar, RowMajor> SparseMatrixType;
+    typedef Triplet<Scalar> TripletType;
+    typedef Matrix<int, Dynamic, Dynamic> IndexMatrixType;
+
+    BasicRadonMatrix(int angles, int numSamples, int gridSize)
+        : m_Forward(angles * numSamples, gridSize * gridSize),
+          m_Backward(gridSize * gridSize, angles),
+          m_numSamples(numSamples),
+          m_gridSize(gridSize)
+    {}
+
+    inline int angles() const
+    { return m_Forward.rows() / m_numSamples; }
+
+    inline int numSamples() const
+    { return m_numSamples; }
+
+    inline int gridSize() const
+    { return m_gridSize; }
+
+    /**
+     * @brief Returns a copy with coefficients of type @a NewScalar.
+     */
+    template <typename NewScalar>
+    BasicRadonMatrix<NewScalar> cast() const
+    {
+        BasicRadonMatrix<NewScalar> A(angles(), m_numSamples, m_gridSize);
+        A.m_Forward = m_Forward.template cast<NewScalar>();
+        A.m_Backward = m_Backward;
+        return A;
+    }
+
+    /**
+     * @brief Sets entries of forward matrix, duplicates are summed up.
+     */
+    void setForward(const std::vector<TripletType> &triplets)
+    { m_Forward.setFromTriplets(triplets.begin(), triplets.end()); }
+
+    /**
+     * @brief Sets the sample index every grid point receives for recording
+     * angle @a n, -1 if it receives none.
+     * @param n Index of recording angle.
+     * @param Index Vector with one entry per grid point (column-major).
+     */
+    void setBackward(const int n, const Matrix<int, Dynamic, 1> &Index)
+    {
+        eigen_assert((Index.size() == m_Backward.rows())
+                     && (Index.minCoeff() >= -1) && (Index.maxCoeff() < m_numSamples));
+        m_Backward.col(n) = Index;
+    }
+
+    /**
+     * @brief Radon-Transform of grid data @a X for recording angle @a n.
+     * @param n Index of recording angle.
+     * @param X Grid data of size [gridSize x gridSize].
+     * @param Radon Row-Vector which receives numSamples values.
+     */
+    template <typename Derived>
+    void project(const int n, const GridType &X, MatrixBase<Derived> &Radon) const
+    {
+        eigen_assert((X.rows() == m_gridSize) && (X.cols() == m_gridSize));
+
+        Map<const Matrix<Scalar, Dynamic, 1> > x(X.data(), X.size());
+        Radon.transpose().noalias() = m_Forward.middleRows(n * m_numSamples, m_numSamples) * x;
+    }
+
+    /**
+     * @brief Backprojection of @a Proj for recording angle @a n.
+     * @param n Index of recording angle.
+     * @param Proj Row-Vector with numSamples values.
+     * @param Xout Grid data, will be resized to [gridSize x gridSize].
+     */
+    template <typename Derived>
+    void backproject(const int n, const MatrixBase<Derived> &Proj, GridType &Xout) const
+    {
+        Xout.resize(m_gridSize, m_gridSize);
+
+        const int *index = m_Backward.col(n).data();
+        Scalar *x = Xout.data();
+        for (int p = 0; p < Xout.size(); ++p)
+            x[p] = (index[p] >= 0) ? Scalar(Proj.coeff(index[p])) : Scalar(0);
+    }
+
+private:
+    template <typename OtherScalar> friend class BasicRadonMatrix;
+
+    SparseMatrixType m_Forward;
+    IndexMatrixType m_Backward; // [gridSize^2 x angles], sample index or -1
+    int m_numSamples;
+    int m_gridSize;
+};
+
+typedef BasicRadonMatrix<double> RadonMatrix;
+typedef BasicRadonMatrix<float> RadonMatrixf;
+
+#endif // RADONMATRIX_H_
@@ -2,27 +2,138 @@
 #define RADONOPERATOR_H_
 
 #include "eigen.h"
-#include "asymreg.h"
 
-#include <map>
+#include <vector>
+
+/**
+ * @brief Coefficients for the extended trapezoidal rule.
+ * The table holds the coefficient vector for every number of samples the
+ * integration of RadonOperator can produce, that is up to 1 + 2/sampleRate
+ * for intervals of length <= 2 (like circleBound() or squareBound()).
+ * It is built once and immutable afterwards, so one instance can be shared
+ * by all RadonOperators and threads and a lookup is a plain index access.
+ */
+class TrapezoidalRule
+{
+public:
+    explicit TrapezoidalRule(double sampleRate)
+        : m_Table(2 + int(2/sampleRate)),
+          m_sampleRate(sampleRate)
+    {
+        /* Trapez:
+         * =======
+         * Vector containing the coefficients for the extended trapezoidal rule.
+         * Trapez = [1/(2*numSamples), 1/numSamples, ..., 1/numSamples, 1/(2*numSamples)]
+         */
+        for (int numSamples = 1; numSamples < int(m_Table.size()); ++numSamples) {
+            Matrix<double, Dynamic, 1> &Trapez = m_Table[numSamples];
+            Trapez.setConstant(numSamples, 1./numSamples);
+            Trapez(0) *= .5;
+            Trapez(numSamples-1) *= .5;
+        }
+    }
+
+    inline const Matrix<double, Dynamic, 1> &operator()(int numSamples) const
+    {
+        eigen_assert((numSamples > 0) && (numSamples < int(m_Table.size())));
+        return m_Table[numSamples];
+    }
+
+    /**
+     * @brief Largest number of samples of a line, see RadonOperator::discretize().
+     */
+    inline int maxSamples() const
+    { return int(m_Table.size()) - 1; }
+
+    /**
+     * @brief Sample rate of the r-axis the table was built for.
+     */
+    inline double sampleRate() const
+    { return m_sampleRate; }
+
+private:
+    std::vector<Matrix<double, Dynamic, 1> > m_Table; // index = numSamples
+    double m_sampleRate;
+};
 
 /**
  * @brief Radon Operator
  * This template class behaves like the Radon Operator.
+ * The buffers of a line are allocated once by the constructor, so operator()
+ * does not allocate memory. Func needs to provide the batched
+ * operator()(const double *pts, int count, double *ret) for this, like
+ * SrcFuncAccOp. One instance must not be used by several threads at once.
  */
 template <typename Func, typename Boundary>
 class RadonOperator
 {
 public:
     RadonOperator(Func &function, /*int gridSize,*/
-                  Boundary &rAxisBoundaryFunction, const Eigen::Vector2d &sigma)
+                  Boundary &rAxisBoundaryFunction, const Eigen::Vector2d &sigma,
+                  const TrapezoidalRule &trapez)
         : m_Func(function),
           /*m_gridSize(gridSize),*/
           m_Boundary(rAxisBoundaryFunction),
-          m_Sigma(sigma)
+          m_Sigma(sigma),
+          m_Trapez(trapez),
+          m_Line(2, trapez.maxSamples()),
+          m_R(trapez.maxSamples()),
+          m_IntData(trapez.maxSamples())
     {}
 
+    /**
+     * @brief Changes the recording angle, so one instance can be used for all angles.
+     */
+    inline void setSigma(const Eigen::Vector2d &sigma)
+    { m_Sigma = sigma; }
+
     double operator()(const double s)
+    {
+        /* sample points along the line and their trapezoidal weights: */
+        int numSamples;
+        const Matrix<double, Dynamic, 1> &Trapez = sampleLine(s, &numSamples);
+
+        /* gather data along Line: */
+        m_Func(m_Line.data(), numSamples, m_IntData.data());
+
+        //std::cout << "data to be integrated = " << std::endl
+        //          << IntData[n] << std::endl << std::endl;
+
+        /* calculate trapezoidal: */
+        double ret = m_IntData.head(numSamples) * Trapez; // mult. vectors [1 x numSamples]*[numSamples x 1]^T
+
+        //std::cout << "integral =" << std::endl
+        //          << ret << std::endl << std::endl;
+
+        return ret;
+    }
+
+    /**
+     * @brief Discretizes the line of integration for @a s.
+     * The sample points of the line are stored in @a Line (one column per point,
+     * in target coord. system) and the coefficients of the extended trapezoidal
+     * rule are returned. The Radon-Transform for @a s is then the weighted sum of
+     * function values at these points, which also allows to assemble the operator
+     * as a matrix (see RadonMatrix).
+     * @param s Sample on the s-axis.
+     * @param Line Matrix which receives the sample points.
+     * @return Vector with trapezoidal weights, one per column in @a Line.
+     */
+    const Matrix<double, Dynamic, 1> &discretize(const double s, Matrix<double, 2, Dynamic> &Line)
+    {
+        int numSamples;
+        const Matrix<double, Dynamic, 1> &Trapez = sampleLine(s, &numSamples);
+        Line = m_Line.leftCols(numSamples);
+
+        return Trapez;
+    }
+
+private:
+    /**
+     * @brief Stores the sample points of the line for @a s in the first
+     * @a numSamples columns of m_Line, see discretize().
+     */
+    const Matrix<double, Dynamic, 1> &sampleLine(const double s, int *numSamples)
     {
         /* get integration boundaries for r-axis: */
         double lower, upper;
@@ -32,23 +143,19 @@ public:
          * ==
          * Discrete samples of r-axis (target coord. system) in the given
          * interval [lower, upper].
-         * The basis for this sampling is the value defined in AR_TRGT_SMPL_RATE
+         * The basis for this sampling is the sample rate of the TrapezoidalRule
          * R_i = lower + i * numSamples for i=0, 1, 2, ...,  and where
-         * numSamples = 1 + ((|lower| + |upper|)/AR_TRGT_SMPL_RATE)
+         * numSamples = 1 + ((|lower| + |upper|)/sampleRate)
          *
          * TODO: use gridSize (like Plotter) as calculation basis
          */
-        int numSamples = 1 + (std::abs(lower) + std::abs(upper))/AR_TRGT_SMPL_RATE;
-        RowVectorXd R = VectorXd::LinSpaced(Sequential, numSamples, lower, upper);
+        const int n = 1 + (std::abs(lower) + std::abs(upper))/m_Trapez.sampleRate();
+        eigen_assert(n <= m_Trapez.maxSamples());
+        auto R = m_R.head(n);
+        R = RowVectorXd::LinSpaced(Sequential, n, lower, upper);
 
         //std::cout << "R =" << std::endl << R << std::endl << std::endl;
 
-        /* Rot90:
-         * ======
-         * Rotation of 90° to get perpendicular angle.
-         */
-        static Matrix<double, 2, 2> Rot90 = Rotation2Dd(M_PI_2).toRotationMatrix(); // M_PI/2
-
         /* Line:
          * =====
          * First part of equation:
@@ -57,51 +164,36 @@ public:
          * Second part of equation:
          *  - translate Line along projection of s * sigma_n
          */
-        Matrix<double, 2, Dynamic> Line = (Rot90 * m_Sigma * R).colwise() + s * m_Sigma;
+        const Vector2d dir = rot90() * m_Sigma;
+        const Vector2d offset = s * m_Sigma;
+        for (int c = 0; c < n; ++c)
+            m_Line.col(c) = dir * R(c) + offset;
 
         //std::cout << "Line(s=" << s << ") = " << std::endl
         //          << Line << std::endl;
 
-        /* gather data along Line: */
-        Matrix<double, 1, Dynamic> IntData = m_Func(Line);
-
-        //std::cout << "data to be integrated = " << std::endl
-        //          << IntData[n] << std::endl << std::endl;
-
-        /* Trapez vectors are cached in map using size (numSamples) as key: */
-        static std::map<int, Matrix<double, Dynamic, 1> > trapezMap;
-        auto it = trapezMap.find(numSamples);
-        if (it == trapezMap.end()) { /* no Trapez vector with appropriate size? ... */
-            /* ... then we construct one & add it to map */
-            Matrix<double, Dynamic, 1> _Trapez;
-            _Trapez.setConstant(numSamples, 1./numSamples);
-            _Trapez(0) *= .5;
-            _Trapez(numSamples-1) *= .5;
-
-            it = trapezMap.insert(it, std::make_pair(numSamples, _Trapez));
-        }
-
-        /* Trapez:
-         * =======
-         * Vector containing the coefficients for the extended trapezoidal rule.
-         * Trapez = [1/(2*numSamples), 1/numSamples, ..., 1/numSamples, 1/(2*numSamples)]
-         * (Trapez-vectors are cached in std::map to speed up)
-         */
-        Matrix<double, Dynamic, 1> *Trapez = &it->second;
-
-        /* calculate trapezoidal: */
-        double ret = IntData * *Trapez; // mult. vectors [1 x numSamples]*[numSamples x 1]^T
-
-        //std::cout << "integral =" << std::endl
-        //          << ret << std::endl << std::endl;
+        /* coefficients for the extended trapezoidal rule (see TrapezoidalRule): */
+        *numSamples = n;
+        return m_Trapez(n);
+    }
 
-        return ret;
+    /* Rot90:
+     * ======
+     * Rotation of 90° to get perpendicular angle.
+     */
+    static const Matrix<double, 2, 2> &rot90()
+    {
+        static const Matrix<double, 2, 2> Rot90 = Rotation2Dd(M_PI_2).toRotationMatrix(); // M_PI/2
+        return Rot90;
     }
 
-private:
     Func &m_Func;
     Boundary &m_Boundary;
     Eigen::Vector2d m_Sigma;
+    const TrapezoidalRule &m_Trapez;
+    Matrix<double, 2, Dynamic> m_Line;    // sample points, first numSamples columns
+    Matrix<double, 1, Dynamic> m_R;       // samples of the r-axis
+    Matrix<double, 1, Dynamic> m_IntData; // data along the line
     //int m_gridSize;
 };
 
@@ -0,0 +1,67 @@
+#ifndef RECONSTRUCTIONCONFIG_H_
+#define RECONSTRUCTIONCONFIG_H_
+
+#include <cmath>
+
+#define ASYMREG_DATSRC_SIZE  30
+
+#define ASYMREG_GRID_SIZE  300
+
+#define AR_NUM_REC_ANGL  100
+
+#define AR_TRGT_SMPL_RATE  0.05
+
+/**
+ * @brief Geometry of a reconstruction.
+ * Holds the sizes which were compile-time constants before, the macros above
+ * are only used as default values. The same configuration has to be passed to
+ * AsymRegEngine::generateDataSet() and AsymRegEngine::regularize().
+ */
+struct ReconstructionConfig
+{
+    ReconstructionConfig()
+        : gridSize(ASYMREG_GRID_SIZE),
+          recordingAngles(AR_NUM_REC_ANGL),
+          sampleRate(AR_TRGT_SMPL_RATE),
+          sourceSize(ASYMREG_DATSRC_SIZE)
+    {}
+
+    /**
+     * @brief Upper limit of numSamples(), every vector of samples is allocated
+     * on the stack with this size if numSamples() is not one of the sizes
+     * compiled as fixed-size (see DerivateOperator).
+     */
+    static constexpr int MaxNumSamples = 1001;
+
+    /**
+     * @brief Number of samples on the s-axis [-1,1].
+     */
+    inline int numSamples() const
+    { return 2/sampleRate + 1; }
+
+    /**
+     * @brief Norm correction for sampled data: ||x||_L2 = l2norm() * ||x||_2
+     */
+    inline double l2norm() const
+    { return std::sqrt(sampleRate); }
+
+    /**
+     * @brief Checks whether all values are usable:
+     * an even number of recording angles (we want that 90° angle) and an
+     * uneven number of samples (we want s = 0).
+     */
+    inline bool isValid() const
+    {
+        return (gridSize >= 2) && (sourceSize >= 2)
+                && (recordingAngles > 0) && (recordingAngles % 2 == 0)
+                && (sampleRate > 0.) && (numSamples() % 2 == 1)
+                && (numSamples() <= MaxNumSamples);
+    }
+
+    int gridSize;        /**< size of the reconstruction grid [gridSize x gridSize] */
+    int recordingAngles; /**< number of recording angles in [0,pi) */
+    double sampleRate;   /**< sample rate of the s- and r-axis (target coord. system) */
+    int sourceSize;      /**< size of the source data [sourceSize x sourceSize] */
+};
+
+#endif // RECONSTRUCTIONCONFIG_H_
@@ -0,0 +1,50 @@
+#include "regularizationworkspace.h"
+
+#ifdef _OPENMP
+#  include <omp.h>
+#endif
+
+template <typename _Scalar>
+RegularizationWorkspace<_Scalar>::RegularizationWorkspace()
+{
+}
+
+/**
+ * @brief Sizes all buffers for @a angles recording angles with @a numSamples
+ * samples each on a grid of [@a gridSize x @a gridSize]. Buffers which already
+ * have the correct size are kept, so a workspace can be reused for several runs.
+ */
+template <typename _Scalar>
+void RegularizationWorkspace<_Scalar>::resize(int angles, int numSamples, int gridSize)
+{
+#ifdef _OPENMP
+    const int threads = omp_get_max_threads();
+#else
+    const int threads = 1;
+#endif
+
+    Xn.resize(gridSize, gridSize);
+    Xdot.resize(gridSize, gridSize);
+    Xprev.resize(gridSize, gridSize);
+
+    dXdt.resize(angles);
+    for (auto &mat : dXdt)
+        mat.resize(gridSize, gridSize);
+
+    stages.resize(threads);
+    for (auto &st : stages) {
+        st.Xs.resize(gridSize, gridSize);
+        st.K2.resize(gridSize, gridSize);
+        st.K3.resize(gridSize, gridSize);
+    }
+
+    RadonXn.resize(angles, numSamples);
+    RadonXdot.resize(angles, numSamples);
+    RadonXprev.resize(angles, numSamples);
+    Error.resize(angles);
+    StepError.resize(angles);
+}
+
+// explicit instantiations:
+template struct RegularizationWorkspace<double>;
+template struct RegularizationWorkspace<float>;
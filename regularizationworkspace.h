@@ -0,0 +1,43 @@
+#ifndef REGULARIZATIONWORKSPACE_H_
+#define REGULARIZATIONWORKSPACE_H_
+
+#include <vector>
+
+#include "eigen.h"
+#include "ode.h"
+
+/**
+ * @brief All buffers needed by AsymRegEngine::regularize().
+ * The workspace is sized once at the beginning of a run by resize(). After
+ * that an iteration of the solver works on these buffers only and does not
+ * allocate heap memory (see AllocationCounter).
+ * The grid data and the projections are of type @a _Scalar (see
+ * AsymRegEngine::Precision), the errors are always double.
+ */
+template <typename _Scalar>
+struct RegularizationWorkspace
+{
+    typedef _Scalar Scalar;
+    typedef Matrix<Scalar, Dynamic, Dynamic> GridType;
+    typedef Matrix<Scalar, Dynamic, Dynamic, RowMajor> ProjectionsType;
+
+    RegularizationWorkspace();
+
+    void resize(int angles, int numSamples, int gridSize);
+
+    GridType Xn;                   /**< current iterate */
+    GridType Xdot;                 /**< next iterate */
+    GridType Xprev;                /**< previous iterate resp. extrapolated point (Nesterov) */
+    std::vector<GridType> dXdt;    /**< derivative resp. increment, one per recording angle */
+    std::vector<ODE::Stages<GridType> > stages; /**< ODE stage buffers, one per thread */
+    ProjectionsType RadonXn;       /**< forward projections of Xn, one row per angle */
+    ProjectionsType RadonXdot;     /**< forward projections of Xdot, one row per angle */
+    ProjectionsType RadonXprev;    /**< forward projections of Xprev, one row per angle */
+    RowVectorXd Error;             /**< error, one per recording angle */
+    RowVectorXd StepError;         /**< error estimate of the adaptive solver, one per recording angle */
+};
+
+extern template struct RegularizationWorkspace<double>;
+extern template struct RegularizationWorkspace<float>;
+
+#endif // REGULARIZATIONWORKSPACE_H_
@@ -0,0 +1,611 @@
+#include "sweep.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <sstream>
+#include <thread>
+#include <utility>
+
+#include <sys/stat.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "logger.h"
+#include "radonmatrix.h"
+
+typedef std::chrono::high_resolution_clock hrc;
+
+/**
+ * @brief One combination of the sweep's parameter grid.
+ */
+struct SweepRun
+{
+    int index;
+    int dataSet; /**< index of the shared data set */
+    ReconstructionConfig config;
+    AsymRegEngine::ODE_Solver solver;
+    AsymRegEngine::Projector projector;
+    AsymRegEngine::Precision precision;
+    AsymRegEngine::InitialGuess initialGuess;
+    int iterations;
+    double delta;
+    double step;
+    bool multilevel;
+};
+
+/**
+ * @brief Outcome of a SweepRun, one row of metrics.csv
+ */
+struct SweepResult
+{
+    int iterationsDone; // summed up over the levels of a multilevel run
+    std::vector<int> levelIterations;
+    double error;
+    double seconds;
+};
+
+// private functions:
+static std::vector<std::string> split(const std::string &list);
+static std::string join(const std::vector<int> &values, char separator);
+template <typename T>
+static bool parseList(const std::string &list, std::vector<T> *values);
+static bool parseSolvers(const std::string &list, std::vector<AsymRegEngine::ODE_Solver> *solvers);
+static bool parseProjectors(const std::string &list, std::vector<AsymRegEngine::Projector> *projectors);
+static bool parseSchedules(const std::string &list, std::vector<bool> *multilevel);
+static bool parsePrecisions(const std::string &list, std::vector<AsymRegEngine::Precision> *precisions);
+static bool parseInitialGuesses(const std::string &list, std::vector<AsymRegEngine::InitialGuess> *guesses);
+static const char *solverName(AsymRegEngine::ODE_Solver solver);
+static const char *projectorName(AsymRegEngine::Projector projector);
+static const char *precisionName(AsymRegEngine::Precision precision);
+static const char *initialGuessName(AsymRegEngine::InitialGuess guess);
+static std::string outputFileName(const char *prefix, int index, const std::string &format);
+
+// function implementations:
+SweepSpec::SweepSpec()
+    : dataFile("../data/data-circle-30x30.csv"),
+      outDir("sweep"),
+      format("csv"),
+      sampleRate(AR_TRGT_SMPL_RATE),
+      seed(1),
+      jobs(1),
+      verifyData(false),
+      solvers({AsymRegEngine::RungeKutta}),
+      projectors({AsymRegEngine::SystemMatrixProjector}),
+      precisions({AsymRegEngine::DoublePrecision}),
+      initialGuesses({AsymRegEngine::ConstantGuess}),
+      angles({AR_NUM_REC_ANGL}),
+      gridSizes({ASYMREG_GRID_SIZE}),
+      iterations({0}),
+      deltas({AR_DELTA}),
+      steps({0.}),
+      multilevel({false})
+{
+}
+
+/**
+ * @brief Parses the command line, every option takes exactly one value.
+ * List options take comma separated values, e.g. "--angles 20,50,100".
+ * @return @c false on error with a message stored in @a error.
+ */
+bool SweepSpec::parse(int argc, char **argv, std::string *error)
+{
+    for (int i = 1; i < argc; ++i) {
+        std::string opt = argv[i];
+        if (i + 1 >= argc) {
+            *error = "missing value for option " + opt;
+            return false;
+        }
+        std::string val = argv[++i];
+
+        bool ok;
+        if (opt == "--data") {
+            dataFile = val;
+            ok = !val.empty();
+        } else if (opt == "--out") {
+            outDir = val;
+            ok = !val.empty();
+        } else if (opt == "--format") {
+            format = val;
+            ok = (val == "csv") || (val == "armx");
+        } else if (opt == "--rate") {
+            ok = (std::sscanf(val.c_str(), "%lf", &sampleRate) == 1) && (sampleRate > 0.);
+        } else if (opt == "--seed") {
+            ok = (std::sscanf(val.c_str(), "%u", &seed) == 1);
+        } else if (opt == "--jobs") {
+            ok = (std::sscanf(val.c_str(), "%d", &jobs) == 1) && (jobs > 0);
+        } else if (opt == "--solver") {
+            ok = parseSolvers(val, &solvers);
+        } else if (opt == "--projector") {
+            ok = parseProjectors(val, &projectors);
+        } else if (opt == "--precision") {
+            ok = parsePrecisions(val, &precisions);
+        } else if (opt == "--initial") {
+            ok = parseInitialGuesses(val, &initialGuesses);
+        } else if (opt == "--angles") {
+            ok = parseList(val, &angles);
+        } else if (opt == "--grid") {
+            ok = parseList(val, &gridSizes);
+        } else if (opt == "--iterations") {
+            ok = parseList(val, &iterations);
+        } else if (opt == "--delta") {
+            ok = parseList(val, &deltas);
+        } else if (opt == "--step") {
+            ok = parseList(val, &steps);
+        } else if (opt == "--schedule") {
+            ok = parseSchedules(val, &multilevel);
+        } else {
+            *error = "unknown option " + opt;
+            return false;
+        }
+
+        if (!ok) {
+            *error = "invalid value \"" + val + "\" for option " + opt;
+            return false;
+        }
+    }
+
+    /* check geometry of all combinations: */
+    ReconstructionConfig config;
+    config.sampleRate = sampleRate;
+    for (int a : angles) {
+        for (int g : gridSizes) {
+            config.recordingAngles = a;
+            config.gridSize = g;
+            if (!config.isValid()) {
+                *error = "invalid geometry: angles = " + std::to_string(a)
+                        + ", grid = " + std::to_string(g)
+                        + ", rate = " + std::to_string(sampleRate);
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Number of runs in the sweep.
+ */
+int SweepSpec::size() const
+{
+    return solvers.size() * projectors.size() * precisions.size() * initialGuesses.size()
+            * angles.size() * gridSizes.size()
+            * iterations.size() * deltas.size() * steps.size() * multilevel.size();
+}
+
+void SweepSpec::printUsage(const char *program)
+{
+    std::cout << "usage: " << program << " [options]" << std::endl
+              << "  without options a single run with the default parameters is done," << std::endl
+              << "  otherwise all combinations of the lists below are run:" << std::endl
+              << "  --data FILE           source data (csv or armx)" << std::endl
+              << "  --out DIR             output directory (run-###, dataset-###, metrics.csv)" << std::endl
+              << "  --format FORMAT       csv (default) or armx (binary) for results and data sets" << std::endl
+              << "  --rate R              sample rate of the s-axis" << std::endl
+              << "  --seed N              seed of the data set perturbation" << std::endl
+              << "  --jobs N              number of runs in parallel" << std::endl
+              << "  --solver LIST         euler, midpoint, rk4, bs23 (adaptive), nesterov" << std::endl
+              << "  --projector LIST      sampled, matrix, fourier (euler & nesterov only)" << std::endl
+              << "  --precision LIST      double, float (matrix projector only)" << std::endl
+              << "  --initial LIST        constant, fbp (filtered backprojection of the data)" << std::endl
+              << "  --angles LIST         number of recording angles" << std::endl
+              << "  --grid LIST           size of the reconstruction grid" << std::endl
+              << "  --iterations LIST     0 uses the discrepancy principle" << std::endl
+              << "  --delta LIST          noise level of the data sets" << std::endl
+              << "  --step LIST           step size, 0 uses the default" << std::endl
+              << "  --schedule LIST       single (target grid only), multilevel (coarse to fine)" << std::endl
+              << "  --log-level LEVEL     error, warning, info (default), verbose or debug" << std::endl
+              << "  --log-json FILE       additionally log as JSON lines to FILE" << std::endl
+              << "  --profile             log a time breakdown of the hot paths after each run" << std::endl
+              << "  --verify              check the checksum of armx source data on load" << std::endl
+              << "  --stream FILE         single run on measured projections, read while" << std::endl
+              << "                        they are appended to FILE (- for stdin)" << std::endl
+              << "  --checkpoint FILE     single run, writes a checkpoint to FILE after" << std::endl
+              << "                        each iteration" << std::endl
+              << "  --resume FILE         single run, continues the run of checkpoint FILE" << std::endl;
+}
+
+/**
+ * @brief Runs all combinations of @a spec.
+ * Data sets and Radon system matrices only depend on a part of the parameters,
+ * so they are created once and shared by all runs using them. The runs are
+ * distributed on @c spec.jobs threads, each owning an AsymRegEngine; the
+ * OpenMP threads are split up between them.
+ * @return 0 on success, otherwise 1.
+ */
+int runSweep(const SweepSpec &spec)
+{
+    /* source data: */
+    MatrixXd zMat;
+    auto zFile = std::make_shared<MappedMatrixFile>(); // *.armx data is mapped and used in place
+    bool imported = false;
+    try {
+        imported = import_matrix_file(spec.dataFile, *zFile, zMat, EIGEN_IOFMT_CSV, spec.verifyData);
+    } catch (const IOFormatException &e) {
+        std::cerr << e.what() << std::endl;
+    }
+
+    const Map<const MatrixXd> zData = zFile->isOpen() ? zFile->map<MatrixXd>()
+                                                      : Map<const MatrixXd>(zMat.data(), zMat.rows(), zMat.cols());
+    if (!imported || (zData.rows() < 2) || (zData.rows() != zData.cols())) {
+        std::cerr << "cannot import data file \"" << spec.dataFile << "\"" << std::endl;
+        return 1;
+    }
+
+    if ((mkdir(spec.outDir.c_str(), 0755) != 0) && (errno != EEXIST)) {
+        std::cerr << "cannot create output directory \"" << spec.outDir << "\"" << std::endl;
+        return 1;
+    }
+
+    /* expand parameter grid: */
+    std::vector<SweepRun> runs;
+    runs.reserve(spec.size());
+    for (auto solver : spec.solvers)
+    for (auto projector : spec.projectors)
+    for (auto precision : spec.precisions)
+    for (auto initialGuess : spec.initialGuesses)
+    for (int angles : spec.angles)
+    for (int grid : spec.gridSizes)
+    for (int iterations : spec.iterations)
+    for (double delta : spec.deltas)
+    for (double step : spec.steps)
+    for (bool multilevel : spec.multilevel) {
+        SweepRun run;
+        run.index = runs.size();
+        run.config.recordingAngles = angles;
+        run.config.gridSize = grid;
+        run.config.sampleRate = spec.sampleRate;
+        run.config.sourceSize = zData.rows();
+        run.solver = solver;
+        run.projector = projector;
+        run.precision = precision;
+        run.initialGuess = initialGuess;
+        run.iterations = iterations;
+        run.delta = delta;
+        run.step = step;
+        run.multilevel = multilevel;
+        runs.push_back(run);
+    }
+
+    Logger::log(Logger::Info, "sweep", "sweep: " + std::to_string(runs.size()) + " runs, "
+                + std::to_string(spec.jobs) + " jobs",
+                {{"runs", int(runs.size())}, {"jobs", spec.jobs}});
+
+    /* shared data sets, one per (angles, delta): */
+    AsymRegEngine source;
+    if (zFile->isOpen())
+        source.createSourceFunction(zData, zFile); // shares the mapping
+    else
+        source.createSourceFunction(zData);
+
+    std::map<std::pair<int, double>, int> dataSetIndex;
+    std::vector<std::vector<RowVectorXd> > dataSets;
+    for (SweepRun &run : runs) {
+        auto key = std::make_pair(run.config.recordingAngles, run.delta);
+        auto it = dataSetIndex.find(key);
+        if (it != dataSetIndex.end()) {
+            run.dataSet = it->second;
+            continue;
+        }
+
+        source.setRandomSeed(spec.seed);
+        source.generateDataSet(run.config, run.delta);
+        run.dataSet = dataSetIndex[key] = dataSets.size();
+        dataSets.push_back(source.dataSet());
+
+        /* one row per recording angle: */
+        const std::vector<RowVectorXd> &y = dataSets.back();
+        MatrixXd Y(y.size(), y[0].size());
+        for (std::size_t n = 0; n < y.size(); ++n)
+            Y.row(n) = y[n];
+        export_matrix_file(spec.outDir + "/" + outputFileName("dataset", run.dataSet, spec.format),
+                           Y, EIGEN_IOFMT_CSV);
+    }
+
+    /* shared system matrices, one per (angles, grid), cast for single precision: */
+    std::map<std::pair<int, int>, std::shared_ptr<const RadonMatrix> > matrices;
+    std::map<std::pair<int, int>, std::shared_ptr<const RadonMatrixf> > matricesF;
+    for (const SweepRun &run : runs) {
+        auto key = std::make_pair(run.config.recordingAngles, run.config.gridSize);
+        if (run.projector != AsymRegEngine::SystemMatrixProjector)
+            continue;
+
+        if (!matrices.count(key))
+            matrices[key] = AsymRegEngine::createSystemMatrix(run.config);
+        if ((run.precision == AsymRegEngine::SinglePrecision) && !matricesF.count(key))
+            matricesF[key] = std::make_shared<RadonMatrixf>(matrices[key]->cast<float>());
+    }
+
+    /* run jobs: */
+    const int jobs = std::min<int>(spec.jobs, runs.size());
+    std::vector<SweepResult> results(runs.size());
+    std::atomic<int> next(0);
+
+    auto worker = [&]() {
+#ifdef _OPENMP
+        omp_set_num_threads(std::max(1, omp_get_num_procs() / jobs));
+#endif
+        AsymRegEngine engine;
+        int iterationsDone;
+        engine.setProgressCallback([&iterationsDone](int, int iteration, double) {
+            iterationsDone = iteration;
+        });
+
+        for (int i = next++; i < (int)runs.size(); i = next++) {
+            const SweepRun &run = runs[i];
+
+            engine.setDataSet(dataSets[run.dataSet]);
+            engine.setPrecision(run.precision);
+            engine.setInitialGuess(run.initialGuess);
+            if (run.projector == AsymRegEngine::SystemMatrixProjector) {
+                auto key = std::make_pair(run.config.recordingAngles, run.config.gridSize);
+                engine.setSystemMatrix(matrices.at(key));
+                if (run.precision == AsymRegEngine::SinglePrecision)
+                    engine.setSystemMatrix(matricesF.at(key));
+            }
+
+            iterationsDone = 0;
+            auto t1 = hrc::now();
+            double err;
+            if (run.multilevel) {
+                err = engine.regularizeMultilevel(run.config, run.delta, run.solver,
+                                                  run.iterations, run.step, nullptr,
+                                                  nullptr, run.projector);
+            } else {
+                err = engine.regularize(run.config, run.delta, run.solver,
+                                        run.iterations, run.step, nullptr,
+                                        nullptr, run.projector);
+            }
+            std::chrono::duration<double> dt = hrc::now() - t1;
+
+            if (run.multilevel) {
+                results[i].levelIterations = engine.levelIterations();
+                iterationsDone = std::accumulate(results[i].levelIterations.begin(),
+                                                 results[i].levelIterations.end(), 0);
+            } else {
+                results[i].levelIterations.assign(1, iterationsDone);
+            }
+            results[i].iterationsDone = iterationsDone;
+            results[i].error = err;
+            results[i].seconds = dt.count();
+
+            export_matrix_file(spec.outDir + "/" + outputFileName("run", i, spec.format),
+                               engine.result(), EIGEN_IOFMT_CSV);
+
+            Logger::log(Logger::Info, "run", "sweep: run " + std::to_string(i+1) + "/"
+                        + std::to_string(runs.size()) + " done (err = " + std::to_string(err) + ")",
+                        {{"run", i}, {"error", err}, {"seconds", dt.count()}});
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int j = 1; j < jobs; ++j)
+        threads.emplace_back(worker);
+    worker();
+    for (auto &t : threads)
+        t.join();
+
+    /* metrics: */
+    std::ofstream metrics(spec.outDir + "/metrics.csv");
+    metrics << "run,file,dataset,solver,projector,precision,initial,schedule,angles,grid,rate,delta,step,max_iterations,"
+               "iterations,level_iterations,error,seconds" << std::endl;
+    metrics.precision(17);
+    for (const SweepRun &run : runs) {
+        const SweepResult &res = results[run.index];
+        metrics << run.index << ','
+                << outputFileName("run", run.index, spec.format) << ','
+                << outputFileName("dataset", run.dataSet, spec.format) << ','
+                << solverName(run.solver) << ','
+                << projectorName(run.projector) << ','
+                << precisionName(run.precision) << ','
+                << initialGuessName(run.initialGuess) << ','
+                << (run.multilevel ? "multilevel" : "single") << ','
+                << run.config.recordingAngles << ','
+                << run.config.gridSize << ','
+                << run.config.sampleRate << ','
+                << run.delta << ','
+                << run.step << ','
+                << run.iterations << ','
+                << res.iterationsDone << ','
+                << join(res.levelIterations, ';') << ','
+                << res.error << ','
+                << res.seconds << std::endl;
+    }
+
+    return metrics ? 0 : 1;
+}
+
+std::vector<std::string> split(const std::string &list)
+{
+    std::vector<std::string> items;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ','))
+        items.push_back(item);
+
+    return items;
+}
+
+std::string join(const std::vector<int> &values, char separator)
+{
+    std::string list;
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        if (i > 0)
+            list += separator;
+        list += std::to_string(values[i]);
+    }
+
+    return list;
+}
+
+template <typename T>
+bool parseList(const std::string &list, std::vector<T> *values)
+{
+    values->clear();
+    for (const std::string &item : split(list)) {
+        std::istringstream is(item);
+        T value;
+        if (!(is >> value) || !is.eof())
+            return false;
+        values->push_back(value);
+    }
+
+    return !values->empty();
+}
+
+bool parseSolvers(const std::string &list, std::vector<AsymRegEngine::ODE_Solver> *solvers)
+{
+    solvers->clear();
+    for (const std::string &item : split(list)) {
+        if (item == "euler")
+            solvers->push_back(AsymRegEngine::Euler);
+        else if (item == "midpoint")
+            solvers->push_back(AsymRegEngine::Midpoint);
+        else if (item == "rk4")
+            solvers->push_back(AsymRegEngine::RungeKutta);
+        else if (item == "bs23")
+            solvers->push_back(AsymRegEngine::BogackiShampine);
+        else if (item == "nesterov")
+            solvers->push_back(AsymRegEngine::Nesterov);
+        else
+            return false;
+    }
+
+    return !solvers->empty();
+}
+
+bool parseSchedules(const std::string &list, std::vector<bool> *multilevel)
+{
+    multilevel->clear();
+    for (const std::string &item : split(list)) {
+        if (item == "single")
+            multilevel->push_back(false);
+        else if (item == "multilevel")
+            multilevel->push_back(true);
+        else
+            return false;
+    }
+
+    return !multilevel->empty();
+}
+
+bool parseProjectors(const std::string &list, std::vector<AsymRegEngine::Projector> *projectors)
+{
+    projectors->clear();
+    for (const std::string &item : split(list)) {
+        if (item == "sampled")
+            projectors->push_back(AsymRegEngine::SampledProjector);
+        else if (item == "matrix")
+            projectors->push_back(AsymRegEngine::SystemMatrixProjector);
+        else if (item == "fourier")
+            projectors->push_back(AsymRegEngine::FourierProjector);
+        else
+            return false;
+    }
+
+    return !projectors->empty();
+}
+
+bool parsePrecisions(const std::string &list, std::vector<AsymRegEngine::Precision> *precisions)
+{
+    precisions->clear();
+    for (const std::string &item : split(list)) {
+        if (item == "double")
+            precisions->push_back(AsymRegEngine::DoublePrecision);
+        else if (item == "float")
+            precisions->push_back(AsymRegEngine::SinglePrecision);
+        else
+            return false;
+    }
+
+    return !precisions->empty();
+}
+
+bool parseInitialGuesses(const std::string &list, std::vector<AsymRegEngine::InitialGuess> *guesses)
+{
+    guesses->clear();
+    for (const std::string &item : split(list)) {
+        if (item == "constant")
+            guesses->push_back(AsymRegEngine::ConstantGuess);
+        else if (item == "fbp")
+            guesses->push_back(AsymRegEngine::FilteredBackprojectionGuess);
+        else
+            return false;
+    }
+
+    return !guesses->empty();
+}
+
+const char *solverName(AsymRegEngine::ODE_Solver solver)
+{
+    switch (solver) {
+    case AsymRegEngine::Euler:
+        return "euler";
+    case AsymRegEngine::Midpoint:
+        return "midpoint";
+    case AsymRegEngine::RungeKutta:
+        return "rk4";
+    case AsymRegEngine::BogackiShampine:
+        return "bs23";
+    case AsymRegEngine::Nesterov:
+        return "nesterov";
+    }
+
+    return "";
+}
+
+const char *projectorName(AsymRegEngine::Projector projector)
+{
+    switch (projector) {
+    case AsymRegEngine::SampledProjector:
+        return "sampled";
+    case AsymRegEngine::SystemMatrixProjector:
+        return "matrix";
+    case AsymRegEngine::FourierProjector:
+        return "fourier";
+    }
+
+    return "";
+}
+
+const char *precisionName(AsymRegEngine::Precision precision)
+{
+    switch (precision) {
+    case AsymRegEngine::DoublePrecision:
+        return "double";
+    case AsymRegEngine::SinglePrecision:
+        return "float";
+    }
+
+    return "";
+}
+
+const char *initialGuessName(AsymRegEngine::InitialGuess guess)
+{
+    switch (guess) {
+    case AsymRegEngine::ConstantGuess:
+        return "constant";
+    case AsymRegEngine::FilteredBackprojectionGuess:
+        return "fbp";
+    }
+
+    return "";
+}
+
+std::string outputFileName(const char *prefix, int index, const std::string &format)
+{
+    char name[64];
+    std::snprintf(name, sizeof(name), "%s-%03d.%s", prefix, index, format.c_str());
+    return name;
+}
@@ -0,0 +1,46 @@
+#ifndef SWEEP_H_
+#define SWEEP_H_
+
+#include <string>
+#include <vector>
+
+#include "asymreg.h"
+
+/**
+ * @brief Parameter grid of a sweep run by the command line tool.
+ * Every parameter is a list, the sweep runs the cartesian product of all
+ * lists. The default values are those of a single run of asymreg-schlieren-cl.
+ */
+struct SweepSpec
+{
+    SweepSpec();
+
+    bool parse(int argc, char **argv, std::string *error);
+
+    int size() const;
+
+    static void printUsage(const char *program);
+
+    std::string dataFile;   /**< source data (csv or armx), its size is detected */
+    std::string outDir;     /**< directory for results, data sets and metrics.csv */
+    std::string format;     /**< file format of results and data sets: "csv" or "armx" */
+    double sampleRate;      /**< sample rate of the s-axis */
+    unsigned seed;          /**< seed of the data set perturbation */
+    int jobs;               /**< number of runs in parallel */
+    bool verifyData;        /**< check the checksum of *.armx source data (--verify) */
+
+    std::vector<AsymRegEngine::ODE_Solver> solvers;
+    std::vector<AsymRegEngine::Projector> projectors;
+    std::vector<AsymRegEngine::Precision> precisions; /**< float needs the matrix projector */
+    std::vector<AsymRegEngine::InitialGuess> initialGuesses;
+    std::vector<int> angles;
+    std::vector<int> gridSizes;
+    std::vector<int> iterations; /**< 0 => discrepancy principle */
+    std::vector<double> deltas;
+    std::vector<double> steps;   /**< 0 => default step size */
+    std::vector<bool> multilevel; /**< false => target grid only, true => coarse to fine */
+};
+
+int runSweep(const SweepSpec &spec);
+
+#endif // SWEEP_H_
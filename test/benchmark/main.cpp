@@ -0,0 +1,475 @@
+/*
+ * Benchmarks of the reconstruction kernels.
+ * Every benchmark is run for several grid sizes and angle counts, the median
+ * time per operation is written as JSON (stdout or file) and/or CSV. A stored baseline
+ * (CSV, see baseline.csv) can be passed to detect regressions, the exit code
+ * is 1 then if a benchmark is slower than the baseline by more than the
+ * tolerance. Baselines depend on the machine, so compare only with one
+ * recorded on the same machine and build type. The exit code is also 1 if an
+ * iteration of the system matrix path allocates heap memory.
+ *
+ * usage: asymreg-benchmark [--json FILE] [--csv FILE] [--filter TEXT]
+ *                          [--baseline FILE] [--tolerance FRACTION]
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef _OPENMP
+#  include <omp.h>
+#endif
+
+#include "alloccounter.h"
+#include "asymreg.h"
+#include "fourierslice.h"
+#include "funcaccop.h"
+#include "logger.h"
+#include "ode.h"
+#include "radonmatrix.h"
+#include "radonoperator.h"
+
+using hrc = std::chrono::high_resolution_clock;
+
+struct Result
+{
+    std::string name;
+    int grid;
+    int angles;
+    int samples;
+    double nsPerOp; // median
+    int reps;       // operations per sample
+
+    std::string key() const
+    { return name + "/" + std::to_string(grid) + "/" + std::to_string(angles); }
+};
+
+// private functions:
+static Result measure(const std::string &name, int grid, int angles, int samples,
+                      const std::function<void ()> &op);
+static void benchKernels(int grid, std::vector<Result> *results);
+static void benchOde(int grid, int angles, std::vector<Result> *results);
+static void benchFourier(int grid, int angles, std::vector<Result> *results);
+static void benchRegularize(int grid, int angles, std::vector<Result> *results);
+static void writeJson(std::ostream &os, const std::vector<Result> &results);
+static void writeCsv(std::ostream &os, const std::vector<Result> &results);
+static bool readBaseline(const std::string &fileName, std::map<std::string, double> *baseline);
+
+static const double MinSampleTime = 0.05; // seconds per sample
+static const int Samples = 5;
+
+static std::string filter;
+static int allocatingBenchmarks = 0;
+
+// function implementations:
+int main(int argc, char **argv)
+{
+    std::string jsonFile, csvFile, baselineFile;
+    double tolerance = 0.15;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string opt = argv[i];
+        if ((opt == "--json") && (i + 1 < argc)) {
+            jsonFile = argv[++i];
+        } else if ((opt == "--csv") && (i + 1 < argc)) {
+            csvFile = argv[++i];
+        } else if ((opt == "--filter") && (i + 1 < argc)) {
+            filter = argv[++i];
+        } else if ((opt == "--baseline") && (i + 1 < argc)) {
+            baselineFile = argv[++i];
+        } else if ((opt == "--tolerance") && (i + 1 < argc)) {
+            tolerance = std::atof(argv[++i]);
+        } else {
+            std::cerr << "usage: " << argv[0] << " [--json FILE] [--csv FILE] [--filter TEXT]"
+                      << " [--baseline FILE] [--tolerance FRACTION]" << std::endl;
+            return 2;
+        }
+    }
+
+    Logger::setLevel(Logger::Error); // keep the engine quiet
+
+    std::vector<Result> results;
+    const int grids[] = { 64, 128, 300 };
+    const int angleCounts[] = { 20, 100 };
+
+    for (int grid : grids)
+        benchKernels(grid, &results);
+
+    for (int grid : grids) {
+        for (int angles : angleCounts) {
+            benchOde(grid, angles, &results);
+            benchFourier(grid, angles, &results);
+            benchRegularize(grid, angles, &results);
+        }
+    }
+
+    /* results: */
+    if (!jsonFile.empty()) {
+        std::ofstream fs(jsonFile);
+        writeJson(fs, results);
+    } else if (csvFile.empty()) {
+        writeJson(std::cout, results);
+    }
+
+    if (!csvFile.empty()) {
+        std::ofstream fs(csvFile);
+        writeCsv(fs, results);
+    }
+
+    /* compare with baseline: */
+    if (baselineFile.empty())
+        return (allocatingBenchmarks > 0) ? 1 : 0;
+
+    std::map<std::string, double> baseline;
+    if (!readBaseline(baselineFile, &baseline)) {
+        std::cerr << "cannot read baseline \"" << baselineFile << "\"" << std::endl;
+        return 2;
+    }
+
+    int regressions = 0;
+    for (const Result &res : results) {
+        auto it = baseline.find(res.key());
+        if (it == baseline.end())
+            continue;
+
+        const double ratio = res.nsPerOp / it->second;
+        const bool regression = ratio > 1. + tolerance;
+        if (regression)
+            ++regressions;
+
+        std::fprintf(stderr, "%-40s %12.0f ns  baseline %12.0f ns  %+6.1f%%%s\n",
+                     res.key().c_str(), res.nsPerOp, it->second, (ratio - 1.) * 100.,
+                     regression ? "  REGRESSION" : "");
+    }
+
+    std::fprintf(stderr, "%d regression(s), tolerance %.0f%%\n", regressions, tolerance * 100.);
+    return ((regressions > 0) || (allocatingBenchmarks > 0)) ? 1 : 0;
+}
+
+/**
+ * @brief Runs @a op repeatedly and returns the median time per call.
+ * The number of calls per sample is calibrated to take at least MinSampleTime.
+ */
+Result measure(const std::string &name, int grid, int angles, int samples,
+               const std::function<void ()> &op)
+{
+    Result res = { name, grid, angles, samples, 0., 1 };
+
+    op(); // warm up (and first touch of all buffers)
+
+    auto t0 = hrc::now();
+    op();
+    std::chrono::duration<double> once = hrc::now() - t0;
+    res.reps = std::max(1, std::min(100000, int(MinSampleTime / std::max(once.count(), 1e-9))));
+
+    std::vector<double> times;
+    for (int k = 0; k < Samples; ++k) {
+        auto t1 = hrc::now();
+        for (int r = 0; r < res.reps; ++r)
+            op();
+        std::chrono::duration<double, std::nano> dt = hrc::now() - t1;
+        times.push_back(dt.count() / res.reps);
+    }
+
+    std::sort(times.begin(), times.end());
+    res.nsPerOp = times[Samples / 2];
+
+    std::fprintf(stderr, "%-40s %12.0f ns\n", res.key().c_str(), res.nsPerOp);
+    return res;
+}
+
+static bool selected(const std::string &name)
+{
+    return filter.empty() || (name.find(filter) != std::string::npos);
+}
+
+/**
+ * @brief Kernels of one recording angle on a [@a grid x @a grid] grid.
+ */
+void benchKernels(int grid, std::vector<Result> *results)
+{
+    const double sampleRate = AR_TRGT_SMPL_RATE;
+    const int numSamples = 2/sampleRate + 1;
+
+    RowVectorXd Xsi = RowVectorXd::LinSpaced(Sequential, grid, 0., 10.);
+    RowVectorXd S = RowVectorXd::LinSpaced(Sequential, numSamples, -1., 1.);
+    MatrixXd X = MatrixXd::Random(grid, grid).array() + 1.;
+    Vector2d sigma(std::cos(M_PI / 6.), std::sin(M_PI / 6.)); // 30°
+
+    BilinearInterpol interp(Xsi, Xsi, X);
+    SrcFuncAccOp sfao(&interp);
+    TrapezoidalRule trapez(sampleRate);
+
+    /* points on the lines of one angle (target coord. system): */
+    RadonOperator<SrcFuncAccOp, void (double, double *, double *)>
+            Radon(sfao, circleBound, sigma, trapez);
+    Matrix<double, 2, Dynamic> Pts, Line;
+    for (int j = 0; j < numSamples; ++j) {
+        Radon.discretize(S(j), Line);
+        Pts.conservativeResize(2, Pts.cols() + Line.cols());
+        Pts.rightCols(Line.cols()) = Line;
+    }
+    Matrix<double, 2, Dynamic> PhysPts = (Translation2d(5, 5) * Scaling(5.0)) * Pts;
+    RowVectorXd Values(Pts.cols());
+
+    if (selected("radon_operator")) {
+        RowVectorXd RadonData(numSamples);
+        results->push_back(measure("radon_operator", grid, 1, numSamples, [&]() {
+            for (int j = 0; j < numSamples; ++j)
+                RadonData(j) = Radon(S(j));
+        }));
+    }
+
+    if (selected("backprojection")) {
+        RowVectorXd Data = RowVectorXd::Random(numSamples);
+        MatrixXd Xout(grid, grid);
+        results->push_back(measure("backprojection", grid, 1, numSamples, [&]() {
+            TrgtFuncAccOp<Projection> tfao(Data);
+            Backprojection<TrgtFuncAccOp<Projection> > R_adjoint(tfao, sigma);
+            backprojectGrid(R_adjoint, Xsi, 2., Xout);
+        }));
+    }
+
+    if (selected("bilinear_interpol")) {
+        results->push_back(measure("bilinear_interpol", grid, 1, PhysPts.cols(), [&]() {
+            interp.interpol(PhysPts, Values);
+        }));
+    }
+
+    if (selected("bilinear_interpol_scalar")) {
+        results->push_back(measure("bilinear_interpol_scalar", grid, 1, PhysPts.cols(), [&]() {
+            for (int i = 0; i < PhysPts.cols(); ++i)
+                Values(i) = interp.interpol(PhysPts(0, i), PhysPts(1, i));
+        }));
+    }
+
+    if (selected("srcfuncaccop")) {
+        results->push_back(measure("srcfuncaccop", grid, 1, Pts.cols(), [&]() {
+            Values = sfao(Pts);
+        }));
+    }
+}
+
+/**
+ * @brief ODE solvers with a trivial right-hand-side, so only the solver's own
+ * work (stages, reduction) is measured. Each operation includes resetting the
+ * increments of all angles.
+ */
+void benchOde(int grid, int angles, std::vector<Result> *results)
+{
+#ifdef _OPENMP
+    const int threads = omp_get_max_threads();
+#else
+    const int threads = 1;
+#endif
+
+    MatrixXd X = MatrixXd::Constant(grid, grid, 0.01);
+    MatrixXd Xout(grid, grid);
+    std::vector<MatrixXd> dXdt(angles, MatrixXd(grid, grid));
+    std::vector<ODE::Stages<MatrixXd> > stages(threads);
+    for (auto &st : stages) {
+        st.Xs.resize(grid, grid);
+        st.K2.resize(grid, grid);
+        st.K3.resize(grid, grid);
+    }
+
+    auto derivs = [](int, const MatrixXd &Xin, MatrixXd &Xd) { Xd = -0.1 * Xin; };
+    auto reset = [&]() {
+        for (auto &d : dXdt)
+            d.setConstant(1e-3);
+    };
+
+    if (selected("ode_euler")) {
+        results->push_back(measure("ode_euler", grid, angles, 0, [&]() {
+            reset();
+            ODE::euler(angles, X, &dXdt[0], 5., Xout, derivs, &stages[0]);
+        }));
+    }
+
+    if (selected("ode_rk2")) {
+        results->push_back(measure("ode_rk2", grid, angles, 0, [&]() {
+            reset();
+            ODE::rk2(angles, X, &dXdt[0], 5., Xout, derivs, &stages[0]);
+        }));
+    }
+
+    if (selected("ode_rk4")) {
+        results->push_back(measure("ode_rk4", grid, angles, 0, [&]() {
+            reset();
+            ODE::rk4(angles, X, &dXdt[0], 5., Xout, derivs, &stages[0]);
+        }));
+    }
+}
+
+/**
+ * @brief FourierSlice projections and Backprojection of all angles, including
+ * the 2D FFT of the grid.
+ */
+void benchFourier(int grid, int angles, std::vector<Result> *results)
+{
+    const double sampleRate = AR_TRGT_SMPL_RATE;
+    const int numSamples = 2/sampleRate + 1;
+
+    MatrixXd Sigma(2, angles);
+    ArrayXd Phi = ArrayXd::LinSpaced(Sequential, angles + 1, 0., M_PI).head(angles);
+    Sigma.row(0) = Phi.cos();
+    Sigma.row(1) = Phi.sin();
+    RowVectorXd S = RowVectorXd::LinSpaced(Sequential, numSamples, -1., 1.);
+    MatrixXd X = MatrixXd::Random(grid, grid).array() + 1.;
+
+    FourierSlice F(Sigma, S, grid, sampleRate);
+
+    if (selected("fourier_project_all")) {
+        RowVectorXd RadonData(numSamples);
+        results->push_back(measure("fourier_project_all", grid, angles, numSamples, [&]() {
+            F.transform(X);
+            for (int n = 0; n < angles; ++n)
+                F.project(n, RadonData.data());
+        }));
+    }
+
+    if (selected("fourier_backproject_all")) {
+        RowVectorXd Data = RowVectorXd::Random(numSamples);
+        MatrixXd Xout(grid, grid);
+        results->push_back(measure("fourier_backproject_all", grid, angles, numSamples, [&]() {
+            for (int n = 0; n < angles; ++n)
+                F.setProjection(n, Data.data());
+            F.backprojectAll(Xout);
+        }));
+    }
+}
+
+/**
+ * @brief One Runge-Kutta iteration of AsymRegEngine::regularize(), taken as
+ * difference of runs with two and one iteration (so the setup is excluded).
+ * The system matrix is assembled beforehand, the float variant runs with
+ * AsymRegEngine::SinglePrecision.
+ */
+void benchRegularize(int grid, int angles, std::vector<Result> *results)
+{
+    const bool sampled = selected("regularize_iteration_sampled");
+    const bool matrix = selected("regularize_iteration_matrix");
+    const bool matrixFloat = selected("regularize_iteration_matrix_float");
+    if (!sampled && !matrix && !matrixFloat)
+        return;
+
+    ReconstructionConfig config;
+    config.gridSize = grid;
+    config.recordingAngles = angles;
+
+    MatrixXd zMat(ASYMREG_DATSRC_SIZE, ASYMREG_DATSRC_SIZE);
+    zMat.setZero();
+    zMat.block(10, 10, 10, 10).setConstant(1.); // square in the middle
+
+    AsymRegEngine engine;
+    engine.createSourceFunction(zMat);
+    engine.setRandomSeed(1);
+    engine.generateDataSet(config);
+
+#ifdef _OPENMP
+    const int threads = omp_get_max_threads();
+#else
+    const int threads = 2; // no parallel regions
+#endif
+
+    auto iteration = [&](const char *name, AsymRegEngine::Projector projector) {
+        Result one = measure(std::string(name) + "@1", grid, angles, config.numSamples(), [&]() {
+            engine.regularize(config, AR_DELTA, AsymRegEngine::RungeKutta, 1, 0., nullptr,
+                              nullptr, projector);
+        });
+        Result two = measure(std::string(name) + "@2", grid, angles, config.numSamples(), [&]() {
+            engine.regularize(config, AR_DELTA, AsymRegEngine::RungeKutta, 2, 0., nullptr,
+                              nullptr, projector);
+        });
+
+        Result res = two;
+        res.name = name;
+        res.nsPerOp = std::max(0., two.nsPerOp - one.nsPerOp);
+        results->push_back(res);
+
+        /* the second iteration must not allocate with any projector
+         * (libgomp allocates the team of a parallel region on one thread): */
+        if (AllocationCounter::isAvailable() && (threads > 1)
+                && (engine.allocationsPerIteration() > 0)) {
+            std::fprintf(stderr, "%-40s %llu heap allocation(s) per iteration\n",
+                         res.key().c_str(), engine.allocationsPerIteration());
+            ++allocatingBenchmarks;
+        }
+    };
+
+    if (sampled)
+        iteration("regularize_iteration_sampled", AsymRegEngine::SampledProjector);
+
+    if (matrix || matrixFloat) {
+        auto A = AsymRegEngine::createSystemMatrix(config);
+        engine.setSystemMatrix(A);
+        if (matrix)
+            iteration("regularize_iteration_matrix", AsymRegEngine::SystemMatrixProjector);
+
+        if (matrixFloat) {
+            engine.setSystemMatrix(std::make_shared<RadonMatrixf>(A->cast<float>()));
+            engine.setPrecision(AsymRegEngine::SinglePrecision);
+            iteration("regularize_iteration_matrix_float", AsymRegEngine::SystemMatrixProjector);
+            engine.setPrecision(AsymRegEngine::DoublePrecision);
+        }
+    }
+}
+
+void writeJson(std::ostream &os, const std::vector<Result> &results)
+{
+    os << "{\n  \"simd\": \"" << Eigen::SimdInstructionSetsInUse() << "\",\n"
+       << "  \"results\": [\n";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const Result &res = results[i];
+        os << "    {\"name\": \"" << res.name << "\", \"grid\": " << res.grid
+           << ", \"angles\": " << res.angles << ", \"samples\": " << res.samples
+           << ", \"ns_per_op\": " << res.nsPerOp << ", \"reps\": " << res.reps << "}"
+           << ((i + 1 < results.size()) ? ",\n" : "\n");
+    }
+    os << "  ]\n}" << std::endl;
+}
+
+void writeCsv(std::ostream &os, const std::vector<Result> &results)
+{
+    os << "# simd: " << Eigen::SimdInstructionSetsInUse() << std::endl
+       << "name,grid,angles,samples,ns_per_op,reps" << std::endl;
+    for (const Result &res : results) {
+        os << res.name << ',' << res.grid << ',' << res.angles << ',' << res.samples << ','
+           << res.nsPerOp << ',' << res.reps << std::endl;
+    }
+}
+
+/**
+ * @brief Reads a baseline written by writeCsv(), lines starting with '#' are
+ * comments.
+ */
+bool readBaseline(const std::string &fileName, std::map<std::string, double> *baseline)
+{
+    std::ifstream fs(fileName);
+    if (!fs.is_open())
+        return false;
+
+    std::string line;
+    while (std::getline(fs, line)) {
+        if (line.empty() || (line[0] == '#') || (line.compare(0, 5, "name,") == 0))
+            continue;
+
+        std::stringstream ss(line);
+        std::string name, grid, angles, samples, ns;
+        std::getline(ss, name, ',');
+        std::getline(ss, grid, ',');
+        std::getline(ss, angles, ',');
+        std::getline(ss, samples, ',');
+        std::getline(ss, ns, ',');
+        (*baseline)[name + "/" + grid + "/" + angles] = std::atof(ns.c_str());
+    }
+
+    return true;
+}